@@ -2,8 +2,11 @@
 #ifndef _ANY_H
 #define _ANY_H
 #include <exception>
+#include <new>
 #include <typeinfo>
 #include <type_traits>
+#include <utility>
+#include "../Memory/Memory.h"
 
 namespace any {
 	class Any;
@@ -12,9 +15,13 @@ namespace any {
 	_Type any_cast(Any& any);
 
 	class bad_any_cast : public std::exception {
+	private:
+		const char* _message = "bad any_cast";
 	public:
 		bad_any_cast() : exception() {}
-		bad_any_cast(const char* message) : exception(message) {}
+		bad_any_cast(const char* message) : exception(), _message(message) {}
+
+		virtual const char* what() const noexcept override { return _message; }
 	};
 };
 
@@ -69,6 +76,15 @@ namespace any {
 		virtual void destroy(void* object) const = 0;
 		virtual void* copy(void* object) const = 0;
 		virtual AbstractTypeFuctions* self_copy() const = 0;
+		virtual void self_destroy() = 0;
+
+		// In-place operations on storage of size() bytes aligned to alignment().
+		virtual size_t size() const = 0;
+		virtual size_t alignment() const = 0;
+		virtual void copy_construct(void* destination, const void* source) const = 0;
+		virtual void move_construct(void* destination, void* source) const = 0;
+		virtual void destroy_at(void* object) const = 0;
+
 		virtual ~AbstractTypeFuctions() {}
 	};
 
@@ -77,13 +93,31 @@ namespace any {
 	{
 	public:
 		virtual void destroy(void* object) const override {
-			delete static_cast<_Type*>(object);
+			memory::destroy<memory::Library::Any>(static_cast<_Type*>(object));
 		}
 		virtual void* copy(void* object) const override {
-			return static_cast<void*>(new _Type(*static_cast<_Type*>(object)));
+			return static_cast<void*>(memory::create<memory::Library::Any, _Type>(*static_cast<_Type*>(object)));
 		}
 		virtual AbstractTypeFuctions* self_copy() const override {
-			return new TypeFuctions<_Type>(*this);
+			return memory::create<memory::Library::Any, TypeFuctions<_Type>>(*this);
+		}
+		virtual void self_destroy() override {
+			memory::destroy<memory::Library::Any>(this);
+		}
+		virtual size_t size() const override {
+			return sizeof(_Type);
+		}
+		virtual size_t alignment() const override {
+			return alignof(_Type);
+		}
+		virtual void copy_construct(void* destination, const void* source) const override {
+			::new (destination) _Type(*static_cast<const _Type*>(source));
+		}
+		virtual void move_construct(void* destination, void* source) const override {
+			::new (destination) _Type(std::move(*static_cast<_Type*>(source)));
+		}
+		virtual void destroy_at(void* object) const override {
+			static_cast<_Type*>(object)->~_Type();
 		}
 		virtual ~TypeFuctions() override {}
 	};
@@ -99,10 +133,10 @@ namespace any {
 	public:
 		Any() {}
 
-		template<class _Type>
+		template<class _Type, class = std::enable_if_t<!std::is_same_v<std::decay_t<_Type>, Any>>>
 		Any(_Type&& object) {
-			_object = static_cast<void*>(new std::remove_reference_t<_Type>(std::forward<_Type>(object)));
-			_type_functions = new TypeFuctions<std::remove_reference_t<_Type>>;
+			_object = static_cast<void*>(memory::create<memory::Library::Any, std::remove_reference_t<_Type>>(std::forward<_Type>(object)));
+			_type_functions = memory::create<memory::Library::Any, TypeFuctions<std::remove_reference_t<_Type>>>();
 			_type_id = typeid(_Type).hash_code();
 		}
 
@@ -125,12 +159,12 @@ namespace any {
 			other._type_id = 0;
 		}
 
-		template<class _Type>
+		template<class _Type, class = std::enable_if_t<!std::is_same_v<std::decay_t<_Type>, Any>>>
 		Any& operator=(_Type&& object) {
 			this->reset();
 
-			_object = static_cast<void*>(new std::remove_reference_t<_Type>(std::forward<_Type>(object)));
-			_type_functions = new TypeFuctions<std::remove_reference_t<_Type>>;
+			_object = static_cast<void*>(memory::create<memory::Library::Any, std::remove_reference_t<_Type>>(std::forward<_Type>(object)));
+			_type_functions = memory::create<memory::Library::Any, TypeFuctions<std::remove_reference_t<_Type>>>();
 			_type_id = typeid(_Type).hash_code();
 			_has_value = true;
 
@@ -178,7 +212,7 @@ namespace any {
 		void reset() {
 			if (_object) {
 				_type_functions->destroy(_object);
-				delete _type_functions;
+				_type_functions->self_destroy();
 				_object = nullptr;
 			}
 		}
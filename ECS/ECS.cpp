@@ -1,4 +1,6 @@
 #include "ECS.h"
+#include <algorithm>
+#include <limits>
 
 namespace ECS {
 	ComponentId Get_component_id() {
@@ -16,10 +18,12 @@ namespace ECS {
 
 	Entity::Entity() : _components(0) {}
 
+	Entity::~Entity() {}
+
 	Entity::Entity(const Entity& other)
 	{
 		_components.reserve(other._components.size());
-		for (size_t i = 0; i < _components.size(); ++i) {
+		for (size_t i = 0; i < other._components.size(); ++i) {
 			if (static_cast<bool>(other._components[i])) {
 				_components.emplace_back(other._components[i]->copy());
 				_components[i]->_entity = this;
@@ -30,17 +34,15 @@ namespace ECS {
 		}
 	}
 
-	Entity::Entity(Entity&& other) noexcept
+	// The components allocator is stateless, so moving the array never allocates.
+	Entity::Entity(Entity&& other)
 	{
-		_components.reserve(other._components.size());
-		for (size_t i = 0; i < _components.size(); ++i) {
-			if (static_cast<bool>(other._components[i])) {
-				_components.emplace_back(std::move(other._components[i]));
-				_components[i]->_entity = this;
-			}
-			else {
-				_components.emplace_back();
-			}
+		if (other._registry) {
+			throw std::logic_error("registry entity cannot be moved");
+		}
+		_components = std::move(other._components);
+		for (auto&& component : _components) {
+			if (component) component->_entity = this;
 		}
 	}
 
@@ -49,10 +51,13 @@ namespace ECS {
 		if (this == &other) {
 			return *this;
 		}
+		if (_registry) {
+			throw std::logic_error("registry entity cannot be assigned");
+		}
 
 		_components.clear();
 		_components.reserve(other._components.size());
-		for (size_t i = 0; i < _components.size(); ++i) {
+		for (size_t i = 0; i < other._components.size(); ++i) {
 			if (static_cast<bool>(other._components[i])) {
 				_components.emplace_back(other._components[i]->copy());
 				_components[i]->_entity = this;
@@ -65,38 +70,488 @@ namespace ECS {
 		return *this;
 	}
 
-	Entity& Entity::operator=(Entity&& other) noexcept
+	Entity& Entity::operator=(Entity&& other)
 	{
 		if (this == &other) {
 			return *this;
 		}
+		if (_registry || other._registry) {
+			throw std::logic_error("registry entity cannot be moved or assigned");
+		}
 
-		_components.clear();
-		_components.reserve(other._components.size());
-		for (size_t i = 0; i < _components.size(); ++i) {
-			if (static_cast<bool>(other._components[i])) {
-				_components.emplace_back(std::move(other._components[i]));
-				_components[i]->_entity = this;
-			}
-			else {
-				_components.emplace_back();
-			}
+		_components = std::move(other._components);
+		for (auto&& component : _components) {
+			if (component) component->_entity = this;
 		}
 
 		return *this;
 	}
 
+	Registry* Entity::registry() const noexcept { return _registry; }
+
 	void Entity::action()
 	{
 		for (auto&& component : _components) {
-			component->action();
+			if (component) component->action();
 		}
 	}
 
 	void Entity::update()
 	{
 		for (auto&& component : _components) {
-			component->update();
+			if (component) component->update();
+		}
+	}
+
+	size_t Registry::DynamicPool::stride(const any::AbstractTypeFuctions& type_functions)
+	{
+		const size_t size = type_functions.size();
+		const size_t alignment = type_functions.alignment();
+		if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+			throw std::invalid_argument("component alignment is not a power of two");
+		}
+		if (size == 0 || size > std::numeric_limits<size_t>::max() - alignment) {
+			throw std::invalid_argument("invalid component size");
+		}
+		return (size + alignment - 1) & ~(alignment - 1);
+	}
+
+	Registry::DynamicPool::DynamicPool(const std::string& name, const any::AbstractTypeFuctions& type_functions) :
+		_name(name),
+		_stride(stride(type_functions)),
+		_type_functions(type_functions.self_copy())
+	{}
+
+	Registry::DynamicPool::~DynamicPool()
+	{
+		for (size_t i = 0; i < _entities.size(); ++i) {
+			_type_functions->destroy_at(data(i));
+		}
+		if (_data) {
+			memory::deallocate<memory::Library::ECS, DynamicPool>(_data, _capacity * _stride, _type_functions->alignment());
+		}
+		_type_functions->self_destroy();
+	}
+
+	// Copy constructs source after the elements of a new buffer before moving them, as source may point
+	// into the old buffer. The old buffer is only released once everything is constructed.
+	void Registry::DynamicPool::grow(const void* source)
+	{
+		const size_t capacity = _capacity ? _capacity * 2 : 8;
+		if (capacity > std::numeric_limits<size_t>::max() / _stride) {
+			throw std::length_error("component pool too large");
+		}
+		_entities.reserve(capacity);
+		const size_t alignment = _type_functions->alignment();
+		unsigned char* data = static_cast<unsigned char*>(memory::allocate<memory::Library::ECS, DynamicPool>(capacity * _stride, alignment));
+		const size_t size = _entities.size();
+		size_t moved = 0;
+		try {
+			_type_functions->copy_construct(data + size * _stride, source);
+			try {
+				for (; moved < size; ++moved) {
+					_type_functions->move_construct(data + moved * _stride, this->data(moved));
+				}
+			}
+			catch (...) {
+				for (size_t i = 0; i < moved; ++i) {
+					_type_functions->destroy_at(data + i * _stride);
+				}
+				_type_functions->destroy_at(data + size * _stride);
+				throw;
+			}
+		}
+		catch (...) {
+			memory::deallocate<memory::Library::ECS, DynamicPool>(data, capacity * _stride, alignment);
+			throw;
+		}
+		for (size_t i = 0; i < size; ++i) {
+			_type_functions->destroy_at(this->data(i));
+		}
+		if (_data) {
+			memory::deallocate<memory::Library::ECS, DynamicPool>(_data, _capacity * _stride, alignment);
+		}
+		_data = data;
+		_capacity = capacity;
+	}
+
+	// Copies source aside first, so a throwing copy leaves the component untouched. If moving the copy
+	// into place throws as well, the destroyed component is removed from the pool.
+	void* Registry::DynamicPool::replace(size_t index, const void* source)
+	{
+		const size_t alignment = _type_functions->alignment();
+		void* copy = memory::allocate<memory::Library::ECS, DynamicPool>(_stride, alignment);
+		try {
+			_type_functions->copy_construct(copy, source);
+		}
+		catch (...) {
+			memory::deallocate<memory::Library::ECS, DynamicPool>(copy, _stride, alignment);
+			throw;
+		}
+		void* component = data(index);
+		_type_functions->destroy_at(component);
+		try {
+			_type_functions->move_construct(component, copy);
+		}
+		catch (...) {
+			remove_at(index);
+			_type_functions->destroy_at(copy);
+			memory::deallocate<memory::Library::ECS, DynamicPool>(copy, _stride, alignment);
+			throw;
+		}
+		_type_functions->destroy_at(copy);
+		memory::deallocate<memory::Library::ECS, DynamicPool>(copy, _stride, alignment);
+		return component;
+	}
+
+	// Removes the entry of an already destroyed component by moving the last component into its place.
+	void Registry::DynamicPool::remove_at(size_t index) noexcept
+	{
+		const size_t last = _entities.size() - 1;
+		_indices[_entities[index]->_registry_slot] = 0;
+		if (index != last) {
+			_type_functions->move_construct(data(index), data(last));
+			_type_functions->destroy_at(data(last));
+			_entities[index] = _entities[last];
+			_indices[_entities[index]->_registry_slot] = index + 1;
+		}
+		_entities.pop_back();
+	}
+
+	void* Registry::DynamicPool::find(const Entity& entity) const noexcept
+	{
+		const size_t slot = entity._registry_slot;
+		if (slot >= _indices.size() || !_indices[slot]) {
+			return nullptr;
+		}
+		return data(_indices[slot] - 1);
+	}
+
+	void* Registry::DynamicPool::emplace(Entity& entity, const void* source)
+	{
+		if (void* component = find(entity)) {
+			if (component != source) {
+				return replace(_indices[entity._registry_slot] - 1, source);
+			}
+			return component;
+		}
+		const size_t slot = entity._registry_slot;
+		if (slot >= _indices.size()) {
+			_indices.resize(slot + 1);
+		}
+		const size_t index = _entities.size();
+		if (index == _capacity) {
+			grow(source);
+		}
+		else {
+			_type_functions->copy_construct(data(index), source);
+		}
+		_entities.emplace_back(&entity);
+		_indices[slot] = _entities.size();
+		return data(index);
+	}
+
+	bool Registry::DynamicPool::erase(Entity& entity)
+	{
+		void* component = find(entity);
+		if (!component) {
+			return false;
+		}
+		_type_functions->destroy_at(component);
+		remove_at(_indices[entity._registry_slot] - 1);
+		return true;
+	}
+
+	Registry::Registry() {}
+
+	Registry::~Registry() {}
+
+	Registry::ComponentSignals& Registry::signals(ComponentId component_id)
+	{
+		if (component_id >= _signals.size()) {
+			_signals.resize(component_id + 1);
+		}
+		if (!_signals[component_id]) {
+			_signals[component_id] = memory::make_unique<memory::Library::ECS, ComponentSignals>();
+		}
+		return *_signals[component_id];
+	}
+
+	Registry::DynamicPool& Registry::pool(ComponentId component_id) const
+	{
+		if (component_id >= _pools.size() || !_pools[component_id]) {
+			throw std::out_of_range("unregistered component");
+		}
+		return *_pools[component_id];
+	}
+
+	unsigned char& Registry::signal_flags(Entity& entity, ComponentId component_id)
+	{
+		if (component_id >= entity._signal_flags.size()) {
+			entity._signal_flags.resize(component_id + 1);
+		}
+		return entity._signal_flags[component_id];
+	}
+
+	bool Registry::is_pending(Entity& entity, ComponentId component_id, Signal signal)
+	{
+		return component_id < entity._signal_flags.size() && (entity._signal_flags[component_id] & pending_flag(signal));
+	}
+
+	void Registry::queue(Entity& entity, ComponentId component_id, Signal signal)
+	{
+		if (entity._pending_destroy) {
+			return;
+		}
+		Vector<Entity*>& batch = signals(component_id).batches[signal];
+		unsigned char& flags = signal_flags(entity, component_id);
+		if (!(flags & queued_flag(signal))) {
+			batch.emplace_back(&entity);
+		}
+		flags |= pending_flag(signal) | queued_flag(signal);
+	}
+
+	void Registry::cancel(Entity& entity, ComponentId component_id, Signal signal)
+	{
+		if (component_id < entity._signal_flags.size()) {
+			entity._signal_flags[component_id] &= static_cast<unsigned char>(~pending_flag(signal));
+		}
+	}
+
+	// Cancelled entries are dropped from the span. Construct and update flags are cleared before the
+	// handlers run, so handlers can queue the entity again for the next flush; a pending destroy is
+	// kept until the component has been released.
+	void Registry::dispatch(Signal signal, ComponentSignal ComponentSignals::* event)
+	{
+		for (ComponentId component_id = 0; component_id < _signals.size(); ++component_id) {
+			if (!_signals[component_id] || _signals[component_id]->batches[signal].empty()) {
+				continue;
+			}
+			_dispatched.swap(_signals[component_id]->batches[signal]);
+			size_t pending_count = 0;
+			for (Entity* entity : _dispatched) {
+				unsigned char& flags = entity->_signal_flags[component_id];
+				flags &= static_cast<unsigned char>(~queued_flag(signal));
+				if (flags & pending_flag(signal)) {
+					if (signal != Destroy) flags &= static_cast<unsigned char>(~pending_flag(signal));
+					_dispatched[pending_count++] = entity;
+				}
+			}
+			_dispatched.resize(pending_count);
+			if (!_dispatched.empty()) {
+				(_signals[component_id].get()->*event)(EntitySpan(_dispatched.data(), _dispatched.size()));
+			}
+			if (signal == Destroy) {
+				for (Entity* entity : _dispatched) {
+					if (is_pending(*entity, component_id, Destroy)) {
+						cancel(*entity, component_id, Destroy);
+						release(*entity, component_id);
+					}
+				}
+			}
+			_dispatched.clear();
+		}
+	}
+
+	void Registry::release(Entity& entity, ComponentId component_id)
+	{
+		if (component_id < _pools.size() && _pools[component_id]) {
+			_pools[component_id]->erase(entity);
+		}
+		else if (component_id < entity._components.size()) {
+			entity._components[component_id].reset();
+		}
+	}
+
+	void Registry::notify_added(Entity& entity, ComponentId component_id, bool replaced)
+	{
+		if (entity._pending_destroy || is_pending(entity, component_id, Construct)) {
+			return;
+		}
+		if (is_pending(entity, component_id, Destroy)) {
+			cancel(entity, component_id, Destroy);
+			queue(entity, component_id, Update);
+		}
+		else {
+			queue(entity, component_id, replaced ? Update : Construct);
+		}
+	}
+
+	void Registry::notify_updated(Entity& entity, ComponentId component_id)
+	{
+		if (!is_pending(entity, component_id, Construct) && !is_pending(entity, component_id, Destroy)) {
+			queue(entity, component_id, Update);
+		}
+	}
+
+	bool Registry::remove(Entity& entity, ComponentId component_id)
+	{
+		if (entity._pending_destroy || is_pending(entity, component_id, Destroy)) {
+			return false;
+		}
+		cancel(entity, component_id, Update);
+		if (is_pending(entity, component_id, Construct)) {
+			cancel(entity, component_id, Construct);
+			release(entity, component_id);
+		}
+		else {
+			queue(entity, component_id, Destroy);
+		}
+		return true;
+	}
+
+	ComponentSignal& Registry::on_construct(ComponentId component_id)
+	{
+		return signals(component_id).on_construct;
+	}
+
+	ComponentSignal& Registry::on_update(ComponentId component_id)
+	{
+		return signals(component_id).on_update;
+	}
+
+	ComponentSignal& Registry::on_destroy(ComponentId component_id)
+	{
+		return signals(component_id).on_destroy;
+	}
+
+	ComponentId Registry::register_component(const std::string& name, const any::AbstractTypeFuctions& type_functions)
+	{
+		for (auto&& component_pool : _pools) {
+			if (component_pool && component_pool->name() == name) {
+				throw std::invalid_argument("component is already registered");
+			}
+		}
+		decltype(auto) component_pool = memory::make_unique<memory::Library::ECS, DynamicPool>(name, type_functions);
+		ComponentId component_id = Get_component_id();
+		if (component_id >= _pools.size()) {
+			_pools.resize(component_id + 1);
+		}
+		_pools[component_id] = std::move(component_pool);
+		return component_id;
+	}
+
+	ComponentId Registry::component_id(const std::string& name) const
+	{
+		for (ComponentId component_id = 0; component_id < _pools.size(); ++component_id) {
+			if (_pools[component_id] && _pools[component_id]->name() == name) {
+				return component_id;
+			}
+		}
+		throw std::out_of_range("unregistered component");
+	}
+
+	void* Registry::add_component(Entity& entity, ComponentId component_id, const void* source)
+	{
+		if (entity._registry != this) {
+			throw std::invalid_argument("entity belongs to another registry");
+		}
+		DynamicPool& component_pool = pool(component_id);
+		const bool replaced = component_pool.find(entity) != nullptr;
+		void* component = nullptr;
+		try {
+			component = component_pool.emplace(entity, source);
+		}
+		catch (...) {
+			if (replaced && !component_pool.find(entity)) {
+				cancel(entity, component_id, Construct);
+				cancel(entity, component_id, Update);
+				cancel(entity, component_id, Destroy);
+			}
+			throw;
+		}
+		notify_added(entity, component_id, replaced);
+		return component;
+	}
+
+	void* Registry::get_component(const Entity& entity, ComponentId component_id) const
+	{
+		if (entity._registry != this) {
+			return nullptr;
+		}
+		return pool(component_id).find(entity);
+	}
+
+	bool Registry::has_component(const Entity& entity, ComponentId component_id) const
+	{
+		return get_component(entity, component_id) != nullptr;
+	}
+
+	bool Registry::remove_component(Entity& entity, ComponentId component_id)
+	{
+		if (!has_component(entity, component_id)) {
+			return false;
+		}
+		return remove(entity, component_id);
+	}
+
+	void Registry::mark_updated(Entity& entity, ComponentId component_id)
+	{
+		if (has_component(entity, component_id)) {
+			notify_updated(entity, component_id);
+		}
+	}
+
+	Entity& Registry::create()
+	{
+		decltype(auto) entity = memory::make_unique<memory::Library::ECS, Entity>();
+		size_t slot = _entities.size();
+		if (!_free_slots.empty()) {
+			slot = _free_slots.back();
+			_entities[slot] = std::move(entity);
+			_free_slots.pop_back();
+		}
+		else {
+			_entities.emplace_back(std::move(entity));
+		}
+		_entities[slot]->_registry = this;
+		_entities[slot]->_registry_slot = slot;
+		return *_entities[slot];
+	}
+
+	void Registry::destroy(Entity& entity)
+	{
+		if (entity._registry != this) {
+			throw std::invalid_argument("entity belongs to another registry");
+		}
+		if (entity._pending_destroy) {
+			return;
+		}
+		for (ComponentId component_id = 0; component_id < entity._components.size(); ++component_id) {
+			if (entity._components[component_id]) {
+				queue(entity, component_id, Destroy);
+			}
+		}
+		for (ComponentId component_id = 0; component_id < _pools.size(); ++component_id) {
+			if (_pools[component_id] && _pools[component_id]->find(entity)) {
+				queue(entity, component_id, Destroy);
+			}
+		}
+		entity._pending_destroy = true;
+		_destroyed_entities.emplace_back(&entity);
+	}
+
+	size_t Registry::size() const noexcept
+	{
+		return _entities.size() - _free_slots.size();
+	}
+
+	void Registry::flush()
+	{
+		_freed_entities.swap(_destroyed_entities);
+
+		dispatch(Construct, &ComponentSignals::on_construct);
+		dispatch(Update, &ComponentSignals::on_update);
+		dispatch(Destroy, &ComponentSignals::on_destroy);
+
+		for (Entity* entity : _freed_entities) {
+			const size_t slot = entity->_registry_slot;
+			for (auto&& component_pool : _pools) {
+				if (component_pool) component_pool->erase(*entity);
+			}
+			_entities[slot].reset();
+			_free_slots.emplace_back(slot);
 		}
+		_freed_entities.clear();
 	}
 }
\ No newline at end of file
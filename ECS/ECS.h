@@ -3,10 +3,20 @@
 #define _ECS_H_
 #include <vector>
 #include <memory>
+#include <string>
+#include <stdexcept>
+#include "../Any/Any.h"
+#include "../Memory/Memory.h"
+#include "../Event System/EventSystem.h"
+
+#ifndef ECS_SIGNAL_CAPACITY
+#define ECS_SIGNAL_CAPACITY 8
+#endif
 
 namespace ECS {
 	class Entity;
 	class Component;
+	class Registry;
 
 	using ComponentId = std::size_t;
 
@@ -18,7 +28,7 @@ namespace ECS {
 		return id;
 	}
 
-	using ComponentsArray = std::vector<std::unique_ptr<Component>>;
+	using ComponentsArray = std::vector<memory::unique_ptr<Component>, memory::Allocator<memory::unique_ptr<Component>, memory::Library::ECS>>;
 
 	class Component {
 	private:
@@ -37,15 +47,25 @@ namespace ECS {
 	};
 
 	class Entity {
+	private:
+		friend class Registry;
 	protected:
 		ComponentsArray _components;
+	private:
+		Registry* _registry = nullptr;
+		size_t _registry_slot = 0;
+		bool _pending_destroy = false;
+		std::vector<unsigned char, memory::Allocator<unsigned char, memory::Library::ECS>> _signal_flags;
 	public:
 		Entity();
+		// Copying a registry entity gives a plain entity. Moving a registry entity, or assigning to one,
+		// would bypass its signals and throws std::logic_error.
 		Entity(const Entity& other);
-		Entity(Entity&& other) noexcept;
+		Entity(Entity&& other);
+		virtual ~Entity();
 
 		Entity& operator=(const Entity& other);
-		Entity& operator=(Entity&& other) noexcept;
+		Entity& operator=(Entity&& other);
 	public:
 		template<class _Component, class... Args>
 		_Component& add_component(Args&&...args);
@@ -56,21 +76,185 @@ namespace ECS {
 		template<class _Component>
 		_Component& get_component() const;
 
+		// Removes the component. A registry entity keeps it until the on_destroy<_Component> handlers
+		// have run on the next flush, unless it was added since the previous flush.
+		template<class _Component>
+		bool remove_component();
+
+		// Queues the entity for on_update<_Component> on the next flush of its registry.
+		template<class _Component>
+		void mark_updated();
+
+		Registry* registry() const noexcept;
+
 		virtual void action();
 		virtual void update();
 	};
-#endif
+
+	// Entities affected by one component signal since the previous flush.
+	class EntitySpan {
+	private:
+		Entity* const* _data;
+		size_t _size;
+	public:
+		EntitySpan(Entity* const* data, size_t size) : _data(data), _size(size) {}
+
+		Entity* const* begin() const noexcept { return _data; }
+		Entity* const* end() const noexcept { return _data + _size; }
+		size_t size() const noexcept { return _size; }
+		bool empty() const noexcept { return _size == 0; }
+		Entity& operator[](size_t index) const noexcept { return *_data[index]; }
+	};
+
+	using ComponentSignal = EventSystem::FixedEvent<ECS_SIGNAL_CAPACITY, EntitySpan>;
+
+	// Owns entities and delivers per component type signals in batches: add_component, mark_updated,
+	// remove_component and destroy only queue the entity, flush() emits one span per signal and type
+	// with every entity at most once. Changes cancel each other within a frame: removing a component
+	// added since the previous flush reports nothing, re-adding a removed one reports an update.
+	// Removed components and destroyed entities stay alive until the on_destroy handlers have run.
+	//
+	// Component types defined at runtime are registered with their any::AbstractTypeFuctions table.
+	// They share the ComponentId space and signals with native components and are stored by value in
+	// one contiguous pool per type; pointers into a pool are invalidated when it grows or loses a component.
+	class Registry {
+	private:
+		friend class Entity;
+		template<class _Type>
+		using Vector = std::vector<_Type, memory::Allocator<_Type, memory::Library::ECS>>;
+
+		enum Signal : unsigned char {
+			Construct,
+			Update,
+			Destroy,
+			SignalsCount
+		};
+
+		// Per entity and component flags: whether a signal is pending and whether the entity is in its batch.
+		static constexpr unsigned char pending_flag(Signal signal) { return static_cast<unsigned char>(1 << signal); }
+		static constexpr unsigned char queued_flag(Signal signal) { return static_cast<unsigned char>(1 << (signal + SignalsCount)); }
+
+		struct ComponentSignals {
+			ComponentSignal on_construct;
+			ComponentSignal on_update;
+			ComponentSignal on_destroy;
+			Vector<Entity*> batches[SignalsCount];
+		};
+
+		class DynamicPool {
+		private:
+			std::string _name;
+			size_t _stride;
+			any::AbstractTypeFuctions* _type_functions;
+			unsigned char* _data = nullptr;
+			size_t _capacity = 0;
+			Vector<Entity*> _entities;
+			Vector<size_t> _indices;
+		private:
+			static size_t stride(const any::AbstractTypeFuctions& type_functions);
+			void grow(const void* source);
+			void* replace(size_t index, const void* source);
+			void remove_at(size_t index) noexcept;
+		public:
+			// Throws std::invalid_argument for a zero size or an alignment that is not a power of two.
+			DynamicPool(const std::string& name, const any::AbstractTypeFuctions& type_functions);
+			DynamicPool(const DynamicPool& other) = delete;
+			DynamicPool& operator=(const DynamicPool& other) = delete;
+			~DynamicPool();
+
+			const std::string& name() const noexcept { return _name; }
+			size_t size() const noexcept { return _entities.size(); }
+			Entity& entity(size_t index) const noexcept { return *_entities[index]; }
+			void* data(size_t index) const noexcept { return _data + index * _stride; }
+
+			void* find(const Entity& entity) const noexcept;
+			// Leaves the pool unchanged when copying source throws. Source may point into the pool.
+			void* emplace(Entity& entity, const void* source);
+			// Swap-removes the component; the type's move constructor must not throw here.
+			bool erase(Entity& entity);
+		};
+	private:
+		Vector<memory::unique_ptr<Entity>> _entities;
+		Vector<size_t> _free_slots;
+		Vector<memory::unique_ptr<ComponentSignals>> _signals;
+		Vector<memory::unique_ptr<DynamicPool>> _pools;
+		Vector<Entity*> _destroyed_entities;
+		Vector<Entity*> _freed_entities;
+		Vector<Entity*> _dispatched;
+	private:
+		ComponentSignals& signals(ComponentId component_id);
+		unsigned char& signal_flags(Entity& entity, ComponentId component_id);
+		bool is_pending(Entity& entity, ComponentId component_id, Signal signal);
+		void queue(Entity& entity, ComponentId component_id, Signal signal);
+		void cancel(Entity& entity, ComponentId component_id, Signal signal);
+		void dispatch(Signal signal, ComponentSignal ComponentSignals::* event);
+		void release(Entity& entity, ComponentId component_id);
+
+		void notify_added(Entity& entity, ComponentId component_id, bool replaced);
+		void notify_updated(Entity& entity, ComponentId component_id);
+		bool remove(Entity& entity, ComponentId component_id);
+		DynamicPool& pool(ComponentId component_id) const;
+	public:
+		Registry();
+		Registry(const Registry& other) = delete;
+		Registry& operator=(const Registry& other) = delete;
+		~Registry();
+
+		Entity& create();
+		void destroy(Entity& entity);
+		size_t size() const noexcept;
+
+		template<class _Component>
+		ComponentSignal& on_construct();
+
+		template<class _Component>
+		ComponentSignal& on_update();
+
+		template<class _Component>
+		ComponentSignal& on_destroy();
+
+		ComponentSignal& on_construct(ComponentId component_id);
+		ComponentSignal& on_update(ComponentId component_id);
+		ComponentSignal& on_destroy(ComponentId component_id);
+
+		// Throws std::invalid_argument for a taken name, a zero size or an alignment that is not a power of two.
+		ComponentId register_component(const std::string& name, const any::AbstractTypeFuctions& type_functions);
+
+		template<class _Type>
+		ComponentId register_component(const std::string& name);
+
+		// Throws std::out_of_range for unknown names.
+		ComponentId component_id(const std::string& name) const;
+
+		// Copy constructs the component from source, replacing the one the entity already has.
+		// If the copy throws the entity keeps its previous component.
+		void* add_component(Entity& entity, ComponentId component_id, const void* source);
+		void* get_component(const Entity& entity, ComponentId component_id) const;
+		bool has_component(const Entity& entity, ComponentId component_id) const;
+		bool remove_component(Entity& entity, ComponentId component_id);
+		void mark_updated(Entity& entity, ComponentId component_id);
+
+		// Calls function(Entity&, void* component) for every component of a registered type, in pool order.
+		template<class _Function>
+		void each(ComponentId component_id, _Function&& function);
+
+		// Emits on_construct, on_update and on_destroy batches and frees destroyed entities.
+		// Handlers may modify the registry; their changes are reported on the next flush.
+		void flush();
+	};
 
 	template<class _Component, class ...Args>
 	inline _Component& Entity::add_component(Args&& ...args)
 	{
 		ComponentId component_id = Get_component_id<_Component>();
-		if (component_id > _components.size() - 1) {
+		if (component_id >= _components.size()) {
 			_components.resize(component_id + 1);
 		}
-		decltype(auto) component = std::make_unique<_Component>(std::forward<Args>(args)...);
+		decltype(auto) component = memory::make_unique<memory::Library::ECS, _Component, Component>(std::forward<Args>(args)...);
 		component->_entity = this;
+		const bool replaced = static_cast<bool>(_components[component_id]);
 		_components[component_id] = std::move(component);
+		if (_registry) _registry->notify_added(*this, component_id, replaced);
 		return get_component<_Component>();
 	}
 
@@ -78,7 +262,7 @@ namespace ECS {
 	inline bool Entity::has_component() const noexcept
 	{
 		ComponentId component_id = Get_component_id<_Component>();
-		if (component_id > _components.size() - 1) {
+		if (component_id >= _components.size()) {
 			return false;
 		}
 		return static_cast<bool>(_components[component_id]);
@@ -88,9 +272,65 @@ namespace ECS {
 	inline _Component& Entity::get_component() const
 	{
 		ComponentId component_id = Get_component_id<_Component>();
-		if (component_id > _components.size() - 1) {
-			throw std::exception("non-contained component");
+		if (component_id >= _components.size() || !_components[component_id]) {
+			throw std::out_of_range("non-contained component");
 		}
 		return static_cast<_Component&>(*_components[component_id]);
 	}
-}
\ No newline at end of file
+
+	template<class _Component>
+	inline bool Entity::remove_component()
+	{
+		if (!has_component<_Component>()) {
+			return false;
+		}
+		ComponentId component_id = Get_component_id<_Component>();
+		if (_registry) {
+			return _registry->remove(*this, component_id);
+		}
+		_components[component_id].reset();
+		return true;
+	}
+
+	template<class _Component>
+	inline void Entity::mark_updated()
+	{
+		if (_registry && has_component<_Component>()) {
+			_registry->notify_updated(*this, Get_component_id<_Component>());
+		}
+	}
+
+	template<class _Component>
+	inline ComponentSignal& Registry::on_construct()
+	{
+		return on_construct(Get_component_id<_Component>());
+	}
+
+	template<class _Component>
+	inline ComponentSignal& Registry::on_update()
+	{
+		return on_update(Get_component_id<_Component>());
+	}
+
+	template<class _Component>
+	inline ComponentSignal& Registry::on_destroy()
+	{
+		return on_destroy(Get_component_id<_Component>());
+	}
+
+	template<class _Type>
+	inline ComponentId Registry::register_component(const std::string& name)
+	{
+		return register_component(name, any::TypeFuctions<_Type>());
+	}
+
+	template<class _Function>
+	inline void Registry::each(ComponentId component_id, _Function&& function)
+	{
+		DynamicPool& component_pool = pool(component_id);
+		for (size_t i = 0; i < component_pool.size(); ++i) {
+			function(component_pool.entity(i), component_pool.data(i));
+		}
+	}
+}
+#endif
\ No newline at end of file
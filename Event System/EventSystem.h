@@ -2,9 +2,19 @@
 #ifndef _EVENTSYSTEM_H_
 #define _EVENTSYSTEM_H_
 #include <list>
+#include <array>
+#include <algorithm>
 #include <functional>
+#include <stdexcept>
 #include <memory>
 #include <type_traits>
+#include "../Memory/Memory.h"
+
+#if (defined(_HAS_CXX17) && _HAS_CXX17) || __cplusplus >= 201703L
+#define _EVENTSYSTEM_HAS_CXX17 1
+#else
+#define _EVENTSYSTEM_HAS_CXX17 0
+#endif
 
 namespace EventSystem {
 	namespace detail {
@@ -39,7 +49,7 @@ namespace EventSystem {
 			template<class _Result, class _Object, class ..._Args>
 			struct __strip_signature<_Result(_Object::*) (_Args...) const volatile&&> { using type = _Result(_Object::*)(_Args...); };
 
-#if _HAS_CXX17
+#if _EVENTSYSTEM_HAS_CXX17
 			template<class _Result, class _Object, class ..._Args>
 			struct __strip_signature<_Result(_Object::*) (_Args...) noexcept> { using type = _Result(_Object::*)(_Args...); };
 			template<class _Result, class _Object, class ..._Args>
@@ -141,7 +151,7 @@ namespace EventSystem {
 			}
 		public:
 			MethodEventHandler(_Object& object, _Method method) : _object(object), _method(method) {
-				if (_method == nullptr) throw std::exception("Undefined method");
+				if (_method == nullptr) throw std::invalid_argument("Undefined method");
 			}
 
 			virtual void call(_Args&... args) override final {
@@ -152,16 +162,16 @@ namespace EventSystem {
 
 	template<class _FunctorHandler>
 	decltype(auto) createFunctorEventHandler(_FunctorHandler&& functor_handler) {
-#if _HAS_CXX17
-		return std::make_shared<handlers::FunctorEventHandler<std::remove_reference_t<_FunctorHandler>, typename detail::get_function_args<decltype(std::function(functor_handler))>::args_pack>>(std::forward<_FunctorHandler>(functor_handler));
+#if _EVENTSYSTEM_HAS_CXX17
+		return memory::make_shared<memory::Library::EventSystem, handlers::FunctorEventHandler<std::remove_reference_t<_FunctorHandler>, typename detail::get_function_args<decltype(std::function(functor_handler))>::args_pack>>(std::forward<_FunctorHandler>(functor_handler));
 #else
-		return std::make_shared<handlers::FunctorEventHandler<std::remove_reference_t<_FunctorHandler>, typename detail::get_function_args<detail::strip::__strip_signature_t<decltype(&_FunctorHandler::operator())>>::args_pack>>(std::forward<_FunctorHandler>(functor_handler));
+		return memory::make_shared<memory::Library::EventSystem, handlers::FunctorEventHandler<std::remove_reference_t<_FunctorHandler>, typename detail::get_function_args<detail::strip::__strip_signature_t<decltype(&_FunctorHandler::operator())>>::args_pack>>(std::forward<_FunctorHandler>(functor_handler));
 #endif
 	}
 
 	template<class _Object, class _Method>
 	decltype(auto) createMethodEventHandler(_Object& object ,_Method&& method) {
-		return std::make_shared<handlers::MethodEventHandler<_Method, detail::strip::__strip_signature_t<_Method>>>(object, method);
+		return memory::make_shared<memory::Library::EventSystem, handlers::MethodEventHandler<_Method, detail::strip::__strip_signature_t<_Method>>>(object, method);
 	}
 
 	template<class... _Args>
@@ -190,7 +200,7 @@ namespace EventSystem {
 		using EventHandler = AbstractEventHandler<_Args...>;
 		using EventHandlerPointer = std::shared_ptr<EventHandler>;
 	private:
-		std::list<EventHandlerPointer> _handlers;
+		std::list<EventHandlerPointer, memory::Allocator<EventHandlerPointer, memory::Library::EventSystem>> _handlers;
 	private:
 		decltype(auto) find_handler(EventHandler& event_handler) {
 			return std::find_if(_handlers.cbegin(), _handlers.cend(), [&event_handler](const EventHandlerPointer& oneHandler)
@@ -221,5 +231,95 @@ namespace EventSystem {
 			}
 		}
 	};
+
+	// Non-owning handler: an object pointer and a stub that calls the bound function, method or functor.
+	// The bound object must outlive the subscription.
+	template<class... _Args>
+	class Delegate {
+	private:
+		using Stub = void(*)(void*, _Args&...);
+		void* _object = nullptr;
+		Stub _stub = nullptr;
+	private:
+		Delegate(void* object, Stub stub) : _object(object), _stub(stub) {}
+	public:
+		Delegate() {}
+
+		template<void(*_Function)(_Args...)>
+		static Delegate create() {
+			return Delegate(nullptr, [](void*, _Args&... args) { _Function(args...); });
+		}
+
+		template<class _Object, void(_Object::*_Method)(_Args...)>
+		static Delegate create(_Object& object) {
+			return Delegate(&object, [](void* object, _Args&... args) { (static_cast<_Object*>(object)->*_Method)(args...); });
+		}
+
+		template<class _Functor>
+		static Delegate create(_Functor& functor) {
+			return Delegate(&functor, [](void* functor, _Args&... args) { (*static_cast<_Functor*>(functor))(args...); });
+		}
+
+		void operator()(_Args&... args) const {
+			_stub(_object, args...);
+		}
+
+		explicit operator bool() const noexcept { return _stub != nullptr; }
+
+		bool operator==(const Delegate& other) const noexcept {
+			return _object == other._object && _stub == other._stub;
+		}
+		bool operator!=(const Delegate& other) const noexcept {
+			return !(*this == other);
+		}
+	};
+
+	// Event with a fixed number of delegate slots: neither subscribing nor emitting allocates.
+	// Unsubscribing from a handler while the event is emitted shifts the later handlers down,
+	// so the handler that follows the removed one is skipped for that emission.
+	template <size_t _Capacity, class... _Args>
+	class FixedEvent {
+	private:
+		using EventHandler = Delegate<_Args...>;
+	private:
+		std::array<EventHandler, _Capacity> _handlers;
+		size_t _count = 0;
+	private:
+		decltype(auto) find_handler(const EventHandler& event_handler) {
+			return std::find(_handlers.begin(), _handlers.begin() + _count, event_handler);
+		}
+	public:
+		// Returns false when the handler is empty or already subscribed.
+		// Throws std::length_error when all slots are taken.
+		bool operator+=(const EventHandler& event_handler) {
+			if (!event_handler || find_handler(event_handler) != _handlers.begin() + _count) {
+				return false;
+			}
+			if (_count == _Capacity) {
+				throw std::length_error("FixedEvent capacity exceeded");
+			}
+			_handlers[_count++] = event_handler;
+			return true;
+		}
+
+		bool operator-=(const EventHandler& event_handler) {
+			decltype(auto) handler_it = find_handler(event_handler);
+			if (handler_it == _handlers.begin() + _count) {
+				return false;
+			}
+			std::move(handler_it + 1, _handlers.begin() + _count, handler_it);
+			_handlers[--_count] = EventHandler();
+			return true;
+		}
+
+		void operator()(_Args... args) const {
+			for (size_t i = 0; i < _count; ++i) {
+				_handlers[i](args...);
+			}
+		}
+
+		size_t size() const noexcept { return _count; }
+		static constexpr size_t capacity() noexcept { return _Capacity; }
+	};
 }
 #endif
\ No newline at end of file
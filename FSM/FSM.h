@@ -4,8 +4,16 @@
 #include <list>
 #include <memory>
 #include <functional>
+#include <stdexcept>
 #include <iostream>
+#include <string>
+#include <vector>
 #include <type_traits>
+#include "../Memory/Memory.h"
+#ifdef FSM_PROFILING
+#include <chrono>
+#include <map>
+#endif
 
 namespace FSM {
 	namespace detail {
@@ -34,15 +42,74 @@ namespace FSM {
 	}
 }
 
+#ifdef FSM_PROFILING
+namespace FSM {
+	namespace profiling {
+		using Clock = std::chrono::steady_clock;
+		using Duration = Clock::duration;
+
+		// Per transition statistics: how often the predicate was evaluated, how often it fired,
+		// the time spent in the predicate and the states it led to.
+		template<class _State>
+		struct TransitionProfile {
+			size_t evaluations = 0;
+			size_t hits = 0;
+			Duration evaluation_time = Duration::zero();
+			std::map<const _State*, size_t> targets;
+		};
+
+		// Per state statistics: calls and time spent in execute() and handle().
+		struct StateProfile {
+			size_t executions = 0;
+			Duration execution_time = Duration::zero();
+			size_t handles = 0;
+			Duration handle_time = Duration::zero();
+		};
+
+		class ScopedTimer {
+		private:
+			Duration& _accumulator;
+			Clock::time_point _start;
+		public:
+			ScopedTimer(Duration& accumulator) : _accumulator(accumulator), _start(Clock::now()) {}
+			~ScopedTimer() { _accumulator += Clock::now() - _start; }
+		};
+
+		inline long long to_nanoseconds(Duration duration) {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+		}
+
+		inline void write_escaped(std::ostream& stream, const std::string& string) {
+			for (char symbol : string) {
+				switch (symbol) {
+				case '"': stream << "\\\""; break;
+				case '\\': stream << "\\\\"; break;
+				case '\n': stream << "\\n"; break;
+				case '\t': stream << "\\t"; break;
+				default: stream << symbol;
+				}
+			}
+		}
+	}
+}
+#endif
+
 namespace FSM {
 	template<class... _Input>
 	class State;
 
+	template<class... _Input>
+	class FSM;
+
 	namespace detail {
 		template<class... _Input>
 		class AbstractTransition {
 		public:
 			virtual State<_Input...>* handle(_Input&... input) = 0;
+			virtual ~AbstractTransition() {}
+#ifdef FSM_PROFILING
+			profiling::TransitionProfile<State<_Input...>> profile;
+#endif
 		};
 
 		template<class _FunctorHandler, class... _Input>
@@ -67,6 +134,7 @@ namespace FSM {
 		class AbstractAction {
 		public:
 			virtual void execute() = 0;
+			virtual ~AbstractAction() {}
 		};
 
 		template<class _Functor>
@@ -87,43 +155,169 @@ namespace FSM {
 	template<class... _Input>
 	class State {
 	private:
+		friend class FSM<_Input...>;
+	private:
+		std::string _name;
 		StateFunctorExecuter _executer;
-		std::unique_ptr<detail::AbstractAction> _entry_action;
-		std::unique_ptr<detail::AbstractAction> _exit_action;
-		std::list<std::unique_ptr<detail::AbstractTransition<_Input...>>> _transitions;
+		memory::unique_ptr<detail::AbstractAction> _entry_action;
+		memory::unique_ptr<detail::AbstractAction> _exit_action;
+		std::list<memory::unique_ptr<detail::AbstractTransition<_Input...>>, memory::Allocator<memory::unique_ptr<detail::AbstractTransition<_Input...>>, memory::Library::FSM>> _transitions;
+		State* _parent = nullptr;
+		State* _initial = nullptr;
+#ifdef FSM_PROFILING
+		profiling::StateProfile _profile;
+#endif
+	private:
+		const State& root() const noexcept {
+			const State* root = this;
+			while (root->_parent) root = root->_parent;
+			return *root;
+		}
+
+		State& initial_leaf() {
+			State* leaf = this;
+			while (leaf->_initial) leaf = leaf->_initial;
+			return *leaf;
+		}
+
+		// Exits the active states up to the closest common ancestor of this state and the target,
+		// then enters the target chain down to its initial leaf.
+		State* transition_to(State& target) {
+			State* domain = target._parent;
+			while (domain && !is_descendant_of(*domain)) domain = domain->_parent;
+			for (State* state = this; state != domain; state = state->_parent) {
+				state->exit();
+			}
+			State& leaf = target.initial_leaf();
+			leaf.enter_from(domain);
+			return &leaf;
+		}
+
+		void enter_from(State* domain) {
+			if (_parent != domain) _parent->enter_from(domain);
+			entry();
+		}
+
+		State* evaluate(detail::AbstractTransition<_Input...>& transition, _Input&... input) {
+#ifdef FSM_PROFILING
+			const auto evaluation_start = profiling::Clock::now();
+			State* new_state = transition.handle(input...);
+			transition.profile.evaluation_time += profiling::Clock::now() - evaluation_start;
+			++transition.profile.evaluations;
+			if (new_state) ++transition.profile.hits;
+			return new_state;
+#else
+			return transition.handle(input...);
+#endif
+		}
+
+		// Evaluates the transitions of this state, then of its ancestors, and returns the first one that
+		// fires together with its target. No action runs, so the caller can still reject the target.
+		detail::AbstractTransition<_Input...>* select(State*& target, _Input&... input) {
+#ifdef FSM_PROFILING
+			const auto handle_start = profiling::Clock::now();
+			++_profile.handles;
+#endif
+			for (State* state = this; state; state = state->_parent) {
+				for (auto&& transition : state->_transitions) {
+					target = state->evaluate(*transition, input...);
+					if (target) {
+#ifdef FSM_PROFILING
+						_profile.handle_time += profiling::Clock::now() - handle_start;
+#endif
+						return transition.get();
+					}
+				}
+			}
+#ifdef FSM_PROFILING
+			_profile.handle_time += profiling::Clock::now() - handle_start;
+#endif
+			return nullptr;
+		}
+
+		// Runs the exit/entry actions of a selected transition; they are not part of the handle time.
+		State* fire(detail::AbstractTransition<_Input...>& transition, State& target) {
+#ifdef FSM_PROFILING
+			++transition.profile.targets[&target];
+#else
+			(void)transition;
+#endif
+			return transition_to(target);
+		}
 	public:
 		State(const StateFunctorExecuter& executer) : _executer(executer) {}
 		State(const StateFunctorExecuter&& executer) : _executer(executer) {}
 
 		State* handle(_Input&... input) {
-			for (auto&& transition : _transitions) {
-				State* new_state = transition->handle(input...);
-				if (new_state) {
-					this->exit();
-					new_state->entry();
-					return new_state;
-				}
-			}
-			return this;
+			State* target = nullptr;
+			detail::AbstractTransition<_Input...>* transition = select(target, input...);
+			return transition ? fire(*transition, *target) : this;
 		}
 
 		void execute() {
+			if (_parent) _parent->execute();
+#ifdef FSM_PROFILING
+			profiling::ScopedTimer execution_timer(_profile.execution_time);
+			++_profile.executions;
+#endif
 			_executer();
 		}
 
+		void set_name(const std::string& name) {
+			_name = name;
+		}
+
+		const std::string& name() const noexcept {
+			return _name;
+		}
+
+		void set_parent(State& parent) {
+			if (parent.is_descendant_of(*this)) throw std::logic_error("Cyclic state hierarchy");
+			_parent = &parent;
+		}
+
+		State* parent() const noexcept {
+			return _parent;
+		}
+
+		void set_initial(State& substate) {
+			if (substate._parent != this) throw std::logic_error("Initial state is not a substate");
+			_initial = &substate;
+		}
+
+		bool is_descendant_of(const State& ancestor) const noexcept {
+			for (const State* state = this; state; state = state->_parent) {
+				if (state == &ancestor) return true;
+			}
+			return false;
+		}
+
+#ifdef FSM_PROFILING
+		const profiling::StateProfile& profile() const noexcept {
+			return _profile;
+		}
+
+		void reset_profile() {
+			_profile = profiling::StateProfile();
+			for (auto&& transition : _transitions) {
+				transition->profile = profiling::TransitionProfile<State>();
+			}
+		}
+#endif
+
 		template<class FunctorHandler>
 		void add_transition(FunctorHandler&& handler){
-			_transitions.emplace_back(std::move(std::make_unique<detail::Transition<FunctorHandler, _Input...>>(std::forward<FunctorHandler>(handler))));
+			_transitions.emplace_back(memory::make_unique<memory::Library::FSM, detail::Transition<FunctorHandler, _Input...>, detail::AbstractTransition<_Input...>>(std::forward<FunctorHandler>(handler)));
 		}
 
 		template<class Functor>
 		void set_entry(Functor&& functor) {
-			_entry_action = std::make_unique<detail::Action<Functor>>(functor);
+			_entry_action = memory::make_unique<memory::Library::FSM, detail::Action<Functor>, detail::AbstractAction>(functor);
 		}
 
 		template<class Functor>
 		void set_exit(Functor&& functor) {
-			_exit_action = std::make_unique<detail::Action<Functor>>(functor);
+			_exit_action = memory::make_unique<memory::Library::FSM, detail::Action<Functor>, detail::AbstractAction>(functor);
 		}
 
 		void entry() {
@@ -139,8 +333,16 @@ namespace FSM {
 	class FSM {
 	private:
 		using __State = State<_Input...>;
-		std::list<__State> _states;
-		__State* _current_state = nullptr;
+
+		// Transition selected for a region in the current handle call.
+		struct Step {
+			detail::AbstractTransition<_Input...>* transition = nullptr;
+			__State* target = nullptr;
+		};
+
+		std::list<__State, memory::Allocator<__State, memory::Library::FSM>> _states;
+		std::vector<__State*, memory::Allocator<__State*, memory::Library::FSM>> _regions;
+		std::vector<Step, memory::Allocator<Step, memory::Library::FSM>> _steps;
 	public:
 		__State& add_state(const StateFunctorExecuter& executer) {
 			_states.emplace_back(executer);
@@ -152,21 +354,165 @@ namespace FSM {
 			return _states.back();
 		}
 
+		__State& add_substate(__State& parent, const StateFunctorExecuter& executer) {
+			__State& state = add_state(executer);
+			state.set_parent(parent);
+			return state;
+		}
+
+		// Handles the input in every orthogonal region. All regions select their transition before any
+		// exit/entry action runs, so a transition into another region throws with no region advanced.
 		template<class... Input>
 		void handle(Input&&... input) {
 			static_assert(detail::args_count_v<_Input...> == detail::args_count_v<Input...>, "The number of arguments is not equal");
-			if (_current_state) _current_state = _current_state->handle(input...);
-			else { throw std::exception("Undefined current state"); }
+			if (_regions.empty()) { throw std::logic_error("Undefined current state"); }
+			for (size_t region = 0; region < _regions.size(); ++region) {
+				Step& step = _steps[region];
+				step.transition = _regions[region]->select(step.target, input...);
+				if (step.transition && overlaps_region(region, *step.target)) {
+					throw std::logic_error("Transition enters another region");
+				}
+			}
+			for (size_t region = 0; region < _regions.size(); ++region) {
+				if (_steps[region].transition) {
+					_regions[region] = _regions[region]->fire(*_steps[region].transition, *_steps[region].target);
+				}
+			}
 		}
 
 		void execute() {
-			if (_current_state) _current_state->execute();
-			else { throw std::exception("Undefined current state"); }
+			if (_regions.empty()) { throw std::logic_error("Undefined current state"); }
+			for (auto&& current_state : _regions) {
+				current_state->execute();
+			}
 		}
 
 		void set_current_state(__State& new_current_state) {
-			_current_state = &new_current_state;
+			if (_regions.empty()) {
+				_steps.emplace_back();
+				_regions.emplace_back(&new_current_state.initial_leaf());
+				return;
+			}
+			if (overlaps_region(0, new_current_state)) throw std::logic_error("State belongs to another region");
+			_regions.front() = &new_current_state.initial_leaf();
 		}
+
+		// Adds an orthogonal region that advances together with the others on every handle call.
+		// Regions must not share states: the initial state's hierarchy may not contain another region.
+		// Hence regions have no common ancestor, and a transition shared by several regions has to be
+		// added to the root of each of them.
+		size_t add_region(__State& initial_state) {
+			if (overlaps_region(_regions.size(), initial_state)) throw std::logic_error("State belongs to another region");
+			_steps.emplace_back();
+			_regions.emplace_back(&initial_state.initial_leaf());
+			return _regions.size() - 1;
+		}
+
+		__State& current_state(size_t region = 0) const {
+			return *_regions.at(region);
+		}
+
+		size_t regions_count() const noexcept {
+			return _regions.size();
+		}
+	private:
+		// Regions are disjoint hierarchies: a state overlaps a region when both share the same root.
+		bool overlaps_region(size_t region, const __State& state) const noexcept {
+			if (_regions.size() == 1 && region == 0) return false;
+			const __State& root = state.root();
+			for (size_t other = 0; other < _regions.size(); ++other) {
+				if (other != region && &_regions[other]->root() == &root) return true;
+			}
+			return false;
+		}
+	public:
+
+#ifdef FSM_PROFILING
+		void reset_profile() {
+			for (auto&& state : _states) {
+				state.reset_profile();
+			}
+		}
+
+		// Writes the machine as a Graphviz digraph: nodes carry execute() statistics,
+		// edges are weighted by the number of times the transition fired.
+		void export_dot(std::ostream& stream) const {
+			const auto indices = state_indices();
+			stream << "digraph FSM {\n";
+			for (auto&& state : _states) {
+				const size_t index = indices.at(&state);
+				stream << "\ts" << index << " [label=\"";
+				write_state_label(stream, state, index);
+				stream << "\\nexecutions: " << state._profile.executions
+					<< "\\nexecution: " << profiling::to_nanoseconds(state._profile.execution_time) << " ns"
+					<< "\\nhandle: " << profiling::to_nanoseconds(state._profile.handle_time) << " ns\"];\n";
+			}
+			for (auto&& state : _states) {
+				size_t transition_index = 0;
+				for (auto&& transition : state._transitions) {
+					const auto& profile = transition->profile;
+					for (auto&& target : profile.targets) {
+						auto target_it = indices.find(target.first);
+						if (target_it == indices.end()) continue;
+						stream << "\ts" << indices.at(&state) << " -> s" << target_it->second
+							<< " [label=\"#" << transition_index << ": " << target.second << "/" << profile.evaluations
+							<< "\\n" << profiling::to_nanoseconds(profile.evaluation_time) << " ns\""
+							<< ", weight=" << target.second << "];\n";
+					}
+					++transition_index;
+				}
+			}
+			stream << "}\n";
+		}
+
+		void export_json(std::ostream& stream) const {
+			const auto indices = state_indices();
+			stream << "{\"states\":[";
+			bool first_state = true;
+			for (auto&& state : _states) {
+				stream << (first_state ? "" : ",") << "{\"id\":" << indices.at(&state) << ",\"name\":\"";
+				profiling::write_escaped(stream, state._name);
+				stream << "\",\"executions\":" << state._profile.executions
+					<< ",\"execution_time_ns\":" << profiling::to_nanoseconds(state._profile.execution_time)
+					<< ",\"handles\":" << state._profile.handles
+					<< ",\"handle_time_ns\":" << profiling::to_nanoseconds(state._profile.handle_time)
+					<< ",\"transitions\":[";
+				bool first_transition = true;
+				for (auto&& transition : state._transitions) {
+					const auto& profile = transition->profile;
+					stream << (first_transition ? "" : ",") << "{\"evaluations\":" << profile.evaluations
+						<< ",\"hits\":" << profile.hits
+						<< ",\"evaluation_time_ns\":" << profiling::to_nanoseconds(profile.evaluation_time)
+						<< ",\"targets\":[";
+					bool first_target = true;
+					for (auto&& target : profile.targets) {
+						auto target_it = indices.find(target.first);
+						if (target_it == indices.end()) continue;
+						stream << (first_target ? "" : ",") << "{\"state\":" << target_it->second << ",\"count\":" << target.second << "}";
+						first_target = false;
+					}
+					stream << "]}";
+					first_transition = false;
+				}
+				stream << "]}";
+				first_state = false;
+			}
+			stream << "]}\n";
+		}
+	private:
+		std::map<const __State*, size_t> state_indices() const {
+			std::map<const __State*, size_t> indices;
+			for (auto&& state : _states) {
+				indices.emplace(&state, indices.size());
+			}
+			return indices;
+		}
+
+		static void write_state_label(std::ostream& stream, const __State& state, size_t index) {
+			if (state._name.empty()) stream << "state " << index;
+			else profiling::write_escaped(stream, state._name);
+		}
+#endif
 	};
 }
 #endif
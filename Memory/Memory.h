@@ -0,0 +1,335 @@
+#pragma once
+#ifndef _MEMORY_H_
+#define _MEMORY_H_
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+namespace memory {
+	enum class Library : size_t {
+		Any,
+		ECS,
+		EventSystem,
+		FSM,
+		Count
+	};
+
+	inline const char* library_name(Library library) {
+		switch (library) {
+		case Library::Any: return "Any";
+		case Library::ECS: return "ECS";
+		case Library::EventSystem: return "EventSystem";
+		case Library::FSM: return "FSM";
+		default: return "Unknown";
+		}
+	}
+
+	struct Statistics {
+		size_t live_bytes = 0;
+		size_t peak_bytes = 0;
+		size_t allocations = 0;
+		size_t deallocations = 0;
+	};
+
+	class AbstractAllocator {
+	public:
+		virtual void* allocate(size_t size, size_t alignment) = 0;
+		virtual void deallocate(void* pointer, size_t size, size_t alignment) noexcept = 0;
+		virtual ~AbstractAllocator() {}
+	};
+
+	class DefaultAllocator : public AbstractAllocator {
+	public:
+		virtual void* allocate(size_t size, size_t alignment) override {
+			if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+				return ::operator new(size, std::align_val_t(alignment));
+			}
+			return ::operator new(size);
+		}
+		virtual void deallocate(void* pointer, size_t size, size_t alignment) noexcept override {
+			if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+				::operator delete(pointer, size, std::align_val_t(alignment));
+			}
+			else {
+				::operator delete(pointer, size);
+			}
+		}
+	};
+}
+
+namespace memory {
+	namespace detail {
+		struct Counters {
+			std::atomic<size_t> live_bytes{ 0 };
+			std::atomic<size_t> peak_bytes{ 0 };
+			std::atomic<size_t> allocations{ 0 };
+			std::atomic<size_t> deallocations{ 0 };
+
+			// Adds the bytes to the live total and returns the new total.
+			size_t reserve(size_t size) noexcept {
+				return live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+			}
+
+			// Counts an allocation whose bytes were reserved; live_bytes_now is the total reserve() returned.
+			void commit(size_t live_bytes_now) noexcept {
+				allocations.fetch_add(1, std::memory_order_relaxed);
+				size_t peak = peak_bytes.load(std::memory_order_relaxed);
+				while (live_bytes_now > peak && !peak_bytes.compare_exchange_weak(peak, live_bytes_now, std::memory_order_relaxed)) {}
+			}
+
+			void cancel(size_t size) noexcept {
+				live_bytes.fetch_sub(size, std::memory_order_relaxed);
+			}
+
+			void on_allocate(size_t size) noexcept {
+				commit(reserve(size));
+			}
+
+			void on_deallocate(size_t size) noexcept {
+				live_bytes.fetch_sub(size, std::memory_order_relaxed);
+				deallocations.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			Statistics snapshot() const noexcept {
+				Statistics statistics;
+				statistics.live_bytes = live_bytes.load(std::memory_order_relaxed);
+				statistics.peak_bytes = peak_bytes.load(std::memory_order_relaxed);
+				statistics.allocations = allocations.load(std::memory_order_relaxed);
+				statistics.deallocations = deallocations.load(std::memory_order_relaxed);
+				return statistics;
+			}
+		};
+
+		struct LibraryCounters : public Counters {
+			std::atomic<size_t> limit{ 0 };
+		};
+
+		// Per type counters form an intrusive list so that they can be enumerated without a registry allocation.
+		struct TypeCounters : public Counters {
+			const std::type_info& type;
+			TypeCounters* next = nullptr;
+
+			TypeCounters(const std::type_info& type_info);
+		};
+
+		inline std::atomic<TypeCounters*>& type_counters_head() {
+			static std::atomic<TypeCounters*> head{ nullptr };
+			return head;
+		}
+
+		inline TypeCounters::TypeCounters(const std::type_info& type_info) : type(type_info) {
+			auto& head = type_counters_head();
+			next = head.load(std::memory_order_relaxed);
+			while (!head.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed)) {}
+		}
+
+		template<class _Type>
+		TypeCounters& type_counters() {
+			static TypeCounters counters(typeid(_Type));
+			return counters;
+		}
+
+		inline LibraryCounters& library_counters(Library library) {
+			static LibraryCounters counters[static_cast<size_t>(Library::Count)];
+			return counters[static_cast<size_t>(library)];
+		}
+
+		inline std::atomic<AbstractAllocator*>& current_allocator() {
+			static DefaultAllocator default_allocator;
+			static std::atomic<AbstractAllocator*> allocator{ &default_allocator };
+			return allocator;
+		}
+	}
+
+	inline AbstractAllocator& allocator() {
+		return *detail::current_allocator().load(std::memory_order_acquire);
+	}
+
+	// Replaces the allocator used by every library. Memory is returned to the allocator that is current
+	// at deallocation time, so the swap is refused with std::logic_error while any library holds memory.
+	// The allocator must stay alive while the libraries use it.
+	inline void set_allocator(AbstractAllocator& new_allocator) {
+		for (size_t i = 0; i < static_cast<size_t>(Library::Count); ++i) {
+			if (detail::library_counters(static_cast<Library>(i)).live_bytes.load(std::memory_order_acquire) != 0) {
+				throw std::logic_error("allocator swap with live allocations");
+			}
+		}
+		detail::current_allocator().store(&new_allocator, std::memory_order_release);
+	}
+
+	inline Statistics statistics(Library library) {
+		return detail::library_counters(library).snapshot();
+	}
+
+	template<class _Type>
+	Statistics type_statistics() {
+		return detail::type_counters<std::remove_cv_t<_Type>>().snapshot();
+	}
+
+	// Calls function(const std::type_info&, const Statistics&) for every type allocated so far.
+	template<class _Function>
+	void for_each_type(_Function&& function) {
+		for (auto counters = detail::type_counters_head().load(std::memory_order_acquire); counters; counters = counters->next) {
+			function(counters->type, counters->snapshot());
+		}
+	}
+
+	// Caps the live bytes of a library: allocations past the limit throw std::bad_alloc. Zero disables the cap.
+	inline void set_limit(Library library, size_t bytes) {
+		detail::library_counters(library).limit.store(bytes, std::memory_order_relaxed);
+	}
+
+	inline size_t limit(Library library) {
+		return detail::library_counters(library).limit.load(std::memory_order_relaxed);
+	}
+
+	// The bytes are reserved against the library limit before allocating, so concurrent allocations
+	// cannot all pass the check and overshoot the limit together.
+	template<Library _Library, class _Accounted>
+	void* allocate(size_t size, size_t alignment) {
+		auto& library_counters = detail::library_counters(_Library);
+		const size_t live_bytes = library_counters.reserve(size);
+		const size_t library_limit = library_counters.limit.load(std::memory_order_relaxed);
+		if (library_limit && live_bytes > library_limit) {
+			library_counters.cancel(size);
+			throw std::bad_alloc();
+		}
+		void* pointer = nullptr;
+		try {
+			pointer = allocator().allocate(size, alignment);
+		}
+		catch (...) {
+			library_counters.cancel(size);
+			throw;
+		}
+		library_counters.commit(live_bytes);
+		detail::type_counters<std::remove_cv_t<_Accounted>>().on_allocate(size);
+		return pointer;
+	}
+
+	template<Library _Library, class _Accounted>
+	void deallocate(void* pointer, size_t size, size_t alignment) noexcept {
+		allocator().deallocate(pointer, size, alignment);
+		detail::library_counters(_Library).on_deallocate(size);
+		detail::type_counters<std::remove_cv_t<_Accounted>>().on_deallocate(size);
+	}
+
+	template<Library _Library, class _Type, class... _Args>
+	_Type* create(_Args&&... args) {
+		void* pointer = allocate<_Library, _Type>(sizeof(_Type), alignof(_Type));
+		try {
+			return ::new (pointer) _Type(std::forward<_Args>(args)...);
+		}
+		catch (...) {
+			deallocate<_Library, _Type>(pointer, sizeof(_Type), alignof(_Type));
+			throw;
+		}
+	}
+
+	template<Library _Library, class _Type>
+	void destroy(_Type* object) noexcept {
+		if (!object) return;
+		object->~_Type();
+		deallocate<_Library, _Type>(const_cast<void*>(static_cast<const volatile void*>(object)), sizeof(_Type), alignof(_Type));
+	}
+
+	namespace detail {
+		template<Library _Library, class _Type, class _Pointer>
+		void destroy_as(_Pointer* object) {
+			destroy<_Library>(static_cast<_Type*>(object));
+		}
+	}
+
+	// Deleter that remembers how the complete object was created, so unique_ptr<Base> releases a derived
+	// object to the right library and type counters. A default constructed deleter falls back to delete
+	// for pointers that were not created here (e.g. returned by user code).
+	template<class _Type>
+	class Deleter {
+	private:
+		using Destroy = void(*)(_Type*);
+		Destroy _destroy = nullptr;
+	public:
+		Deleter() noexcept {}
+		Deleter(Destroy destroy) noexcept : _destroy(destroy) {}
+
+		void operator()(_Type* object) const noexcept {
+			if (_destroy) _destroy(object);
+			else delete object;
+		}
+	};
+
+	template<class _Type>
+	using unique_ptr = std::unique_ptr<_Type, Deleter<_Type>>;
+
+	template<Library _Library, class _Type, class _Pointer = _Type, class... _Args>
+	unique_ptr<_Pointer> make_unique(_Args&&... args) {
+		static_assert(std::is_same_v<_Type, _Pointer> || std::has_virtual_destructor_v<_Pointer>, "The pointer type must have a virtual destructor");
+		return unique_ptr<_Pointer>(create<_Library, _Type>(std::forward<_Args>(args)...), &detail::destroy_as<_Library, _Type, _Pointer>);
+	}
+
+	// Stateless standard allocator; rebound allocators (list nodes, shared_ptr control blocks) keep
+	// accounting their memory to _Accounted.
+	template<class _Type, Library _Library, class _Accounted = _Type>
+	class Allocator {
+	public:
+		using value_type = _Type;
+
+		template<class _Other>
+		struct rebind { using other = Allocator<_Other, _Library, _Accounted>; };
+
+		Allocator() noexcept {}
+		template<class _Other>
+		Allocator(const Allocator<_Other, _Library, _Accounted>&) noexcept {}
+
+		_Type* allocate(size_t count) {
+			return static_cast<_Type*>(memory::allocate<_Library, _Accounted>(count * sizeof(_Type), alignof(_Type)));
+		}
+
+		void deallocate(_Type* pointer, size_t count) noexcept {
+			memory::deallocate<_Library, _Accounted>(pointer, count * sizeof(_Type), alignof(_Type));
+		}
+
+		template<class _Other>
+		bool operator==(const Allocator<_Other, _Library, _Accounted>&) const noexcept { return true; }
+		template<class _Other>
+		bool operator!=(const Allocator<_Other, _Library, _Accounted>&) const noexcept { return false; }
+	};
+
+	template<Library _Library, class _Type, class... _Args>
+	std::shared_ptr<_Type> make_shared(_Args&&... args) {
+		return std::allocate_shared<_Type>(Allocator<_Type, _Library>(), std::forward<_Args>(args)...);
+	}
+
+	inline void write_json(std::ostream& stream) {
+		auto write_statistics = [&stream](const Statistics& statistics) {
+			stream << "\"live_bytes\":" << statistics.live_bytes
+				<< ",\"peak_bytes\":" << statistics.peak_bytes
+				<< ",\"allocations\":" << statistics.allocations
+				<< ",\"deallocations\":" << statistics.deallocations;
+		};
+
+		stream << "{\"libraries\":[";
+		for (size_t i = 0; i < static_cast<size_t>(Library::Count); ++i) {
+			const Library library = static_cast<Library>(i);
+			stream << (i ? "," : "") << "{\"name\":\"" << library_name(library) << "\",\"limit\":" << limit(library) << ",";
+			write_statistics(statistics(library));
+			stream << "}";
+		}
+		stream << "],\"types\":[";
+		bool first = true;
+		for_each_type([&](const std::type_info& type, const Statistics& statistics) {
+			stream << (first ? "" : ",") << "{\"name\":\"" << type.name() << "\",";
+			write_statistics(statistics);
+			stream << "}";
+			first = false;
+		});
+		stream << "]}\n";
+	}
+}
+#endif
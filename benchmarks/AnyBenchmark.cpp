@@ -0,0 +1,54 @@
+#include <string>
+#include "Benchmark.h"
+#include "Any.h"
+
+int main(int argc, char** argv) {
+	benchmark::Runner runner("Any", argc, argv);
+
+	runner.run("construct/int", 1, [] {
+		any::Any value(42);
+		benchmark::do_not_optimize(value);
+	});
+
+	runner.run("construct/string", 1, [] {
+		any::Any value(std::string("a string that does not fit the small buffer"));
+		benchmark::do_not_optimize(value);
+	});
+
+	const any::Any int_source(42);
+	runner.run("copy/int", 1, [&] {
+		any::Any value(int_source);
+		benchmark::do_not_optimize(value);
+	});
+
+	const any::Any string_source(std::string("a string that does not fit the small buffer"));
+	runner.run("copy/string", 1, [&] {
+		any::Any value(string_source);
+		benchmark::do_not_optimize(value);
+	});
+
+	any::Any moved(42);
+	runner.run("move/int", 2, [&] {
+		any::Any value(std::move(moved));
+		moved = std::move(value);
+		benchmark::do_not_optimize(moved);
+	});
+
+	any::Any cast_source(42);
+	runner.run("cast/value", 1, [&] {
+		int value = any::any_cast<int>(cast_source);
+		benchmark::do_not_optimize(value);
+	});
+
+	runner.run("cast/pointer", 1, [&] {
+		int* value = any::any_cast<int*>(cast_source);
+		benchmark::do_not_optimize(value);
+	});
+
+	runner.run("cast/pointer_mismatch", 1, [&] {
+		double* value = any::any_cast<double*>(cast_source);
+		benchmark::do_not_optimize(value);
+	});
+
+	return runner.finish();
+}
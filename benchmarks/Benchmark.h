@@ -0,0 +1,124 @@
+#pragma once
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace benchmark {
+	template<class _Type>
+	inline void do_not_optimize(_Type&& value) {
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "g"(&value) : "memory");
+#else
+		static volatile const void* sink;
+		sink = &value;
+#endif
+	}
+
+	struct Result {
+		std::string name;
+		size_t iterations = 0;
+		size_t samples = 0;
+		double ns_per_op = 0;
+		double min_ns_per_op = 0;
+	};
+
+	// Runs the registered benchmarks of one suite and writes the results as JSON:
+	// {"schema":1,"suite":"...","benchmarks":[{"name":"...","iterations":N,"samples":N,"ns_per_op":X,"min_ns_per_op":X}]}
+	// ns_per_op is the median over the samples. Command line:
+	//   --quick          one short sample per benchmark (smoke run)
+	//   --output <file>  write the JSON results to the file
+	//   --filter <text>  run only the benchmarks whose name contains the text
+	class Runner {
+	private:
+		using Clock = std::chrono::steady_clock;
+	private:
+		std::string _suite;
+		std::string _output;
+		std::string _filter;
+		size_t _samples = 5;
+		Clock::duration _sample_time = std::chrono::milliseconds(50);
+		std::vector<Result> _results;
+	public:
+		Runner(const std::string& suite, int argc, char** argv) : _suite(suite) {
+			for (int i = 1; i < argc; ++i) {
+				if (std::strcmp(argv[i], "--quick") == 0) {
+					_samples = 1;
+					_sample_time = std::chrono::microseconds(100);
+				}
+				else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+					_output = argv[++i];
+				}
+				else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+					_filter = argv[++i];
+				}
+			}
+		}
+
+		// The body performs operations_per_iteration operations each time it is called.
+		template<class _Body>
+		void run(const std::string& name, size_t operations_per_iteration, _Body&& body) {
+			if (!_filter.empty() && name.find(_filter) == std::string::npos) return;
+
+			size_t iterations = 1;
+			while (measure(iterations, body) < _sample_time && iterations < (size_t(1) << 40)) {
+				iterations *= 2;
+			}
+
+			std::vector<double> samples;
+			for (size_t sample = 0; sample < _samples; ++sample) {
+				const double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(measure(iterations, body)).count());
+				samples.emplace_back(elapsed / static_cast<double>(iterations * operations_per_iteration));
+			}
+			std::sort(samples.begin(), samples.end());
+
+			Result result;
+			result.name = name;
+			result.iterations = iterations;
+			result.samples = samples.size();
+			result.ns_per_op = samples[samples.size() / 2];
+			result.min_ns_per_op = samples.front();
+			std::cout << _suite << "/" << name << ": " << result.ns_per_op << " ns/op (" << iterations << " iterations)" << std::endl;
+			_results.emplace_back(result);
+		}
+
+		int finish() const {
+			if (_output.empty()) return 0;
+			std::ofstream stream(_output);
+			if (!stream) {
+				std::cerr << "Cannot open " << _output << std::endl;
+				return 1;
+			}
+			write_json(stream);
+			return 0;
+		}
+
+		void write_json(std::ostream& stream) const {
+			stream << "{\n\t\"schema\": 1,\n\t\"suite\": \"" << _suite << "\",\n\t\"benchmarks\": [";
+			for (size_t i = 0; i < _results.size(); ++i) {
+				const Result& result = _results[i];
+				stream << (i ? "," : "") << "\n\t\t{\"name\": \"" << result.name
+					<< "\", \"iterations\": " << result.iterations
+					<< ", \"samples\": " << result.samples
+					<< ", \"ns_per_op\": " << result.ns_per_op
+					<< ", \"min_ns_per_op\": " << result.min_ns_per_op << "}";
+			}
+			stream << "\n\t]\n}\n";
+		}
+	private:
+		template<class _Body>
+		static Clock::duration measure(size_t iterations, _Body& body) {
+			const auto start = Clock::now();
+			for (size_t i = 0; i < iterations; ++i) {
+				body();
+			}
+			return Clock::now() - start;
+		}
+	};
+}
+#endif
@@ -0,0 +1,131 @@
+#include <map>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "ECS.h"
+
+namespace {
+	struct Position : public ECS::Component {
+		float x = 0, y = 0;
+		virtual Component* copy() const override { return new Position(*this); }
+	};
+
+	struct Velocity : public ECS::Component {
+		float dx = 1, dy = 1;
+		virtual void update() override {
+			Position& position = entity().get_component<Position>();
+			position.x += dx;
+			position.y += dy;
+		}
+		virtual Component* copy() const override { return new Velocity(*this); }
+	};
+
+	const size_t entity_counts[] = { 100, 1000, 10000 };
+}
+
+int main(int argc, char** argv) {
+	benchmark::Runner runner("ECS", argc, argv);
+
+	runner.run("add_component", 2, [] {
+		ECS::Entity entity;
+		entity.add_component<Position>();
+		entity.add_component<Velocity>();
+		benchmark::do_not_optimize(entity);
+	});
+
+	for (size_t entity_count : entity_counts) {
+		std::vector<ECS::Entity> entities(entity_count);
+		for (size_t i = 0; i < entity_count; ++i) {
+			entities[i].add_component<Position>();
+			if (i % 2 == 0) entities[i].add_component<Velocity>();
+		}
+
+		runner.run("iterate/update/" + std::to_string(entity_count), entity_count, [&] {
+			for (auto&& entity : entities) {
+				entity.update();
+			}
+		});
+
+		runner.run("iterate/get_component/" + std::to_string(entity_count), entity_count, [&] {
+			float sum = 0;
+			for (auto&& entity : entities) {
+				if (entity.has_component<Velocity>()) {
+					sum += entity.get_component<Position>().x;
+				}
+			}
+			benchmark::do_not_optimize(sum);
+		});
+	}
+
+	for (size_t entity_count : entity_counts) {
+		// Reacting to components added to a tenth of the entities: polling every entity
+		// against one batched on_construct signal per flush.
+		ECS::Registry registry;
+		std::vector<ECS::Entity*> entities;
+		for (size_t i = 0; i < entity_count; ++i) {
+			entities.emplace_back(&registry.create());
+			entities.back()->add_component<Position>();
+		}
+		registry.flush();
+
+		size_t reacted = 0;
+		auto on_construct = [&reacted](ECS::EntitySpan span) { reacted += span.size(); };
+		registry.on_construct<Velocity>() += EventSystem::Delegate<ECS::EntitySpan>::create(on_construct);
+
+		runner.run("react/poll/" + std::to_string(entity_count), 1, [&] {
+			for (size_t i = 0; i < entity_count; i += 10) {
+				entities[i]->add_component<Velocity>();
+			}
+			for (auto&& entity : entities) {
+				if (entity->has_component<Velocity>()) ++reacted;
+			}
+			for (size_t i = 0; i < entity_count; i += 10) {
+				entities[i]->remove_component<Velocity>();
+			}
+			registry.flush();
+			benchmark::do_not_optimize(reacted);
+		});
+
+		runner.run("react/signal/" + std::to_string(entity_count), 1, [&] {
+			for (size_t i = 0; i < entity_count; i += 10) {
+				entities[i]->add_component<Velocity>();
+			}
+			registry.flush();
+			for (size_t i = 0; i < entity_count; i += 10) {
+				entities[i]->remove_component<Velocity>();
+			}
+			registry.flush();
+			benchmark::do_not_optimize(reacted);
+		});
+	}
+
+	for (size_t entity_count : entity_counts) {
+		// A runtime registered component stored in its registry pool, against the same data
+		// kept in a per entity name -> any::Any map.
+		ECS::Registry registry;
+		const ECS::ComponentId speed = registry.register_component<float>("speed");
+		std::vector<std::map<std::string, any::Any>> scripted(entity_count);
+		for (size_t i = 0; i < entity_count; ++i) {
+			float value = static_cast<float>(i);
+			registry.add_component(registry.create(), speed, &value);
+			scripted[i]["speed"] = value;
+		}
+		registry.flush();
+
+		runner.run("iterate/dynamic/" + std::to_string(entity_count), entity_count, [&] {
+			float sum = 0;
+			registry.each(speed, [&sum](ECS::Entity&, void* component) { sum += *static_cast<float*>(component); });
+			benchmark::do_not_optimize(sum);
+		});
+
+		runner.run("iterate/any_map/" + std::to_string(entity_count), entity_count, [&] {
+			float sum = 0;
+			for (auto&& components : scripted) {
+				sum += any::any_cast<float>(components.at("speed"));
+			}
+			benchmark::do_not_optimize(sum);
+		});
+	}
+
+	return runner.finish();
+}
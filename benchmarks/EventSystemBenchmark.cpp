@@ -0,0 +1,56 @@
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "EventSystem.h"
+
+namespace {
+	struct Receiver {
+		int sum = 0;
+		void on_event(int value) { sum += value; }
+	};
+
+	const size_t handler_counts[] = { 1, 10, 100, 1000, 10000 };
+}
+
+int main(int argc, char** argv) {
+	benchmark::Runner runner("EventSystem", argc, argv);
+
+	for (size_t handler_count : handler_counts) {
+		int sum = 0;
+		std::vector<std::shared_ptr<EventSystem::AbstractEventHandler<int>>> handlers;
+		for (size_t i = 0; i < handler_count; ++i) {
+			handlers.emplace_back(EventSystem::createFunctorEventHandler([&sum](int value) { sum += value; }));
+		}
+
+		runner.run("subscribe/functor/" + std::to_string(handler_count), handler_count, [&] {
+			EventSystem::Event<int> event;
+			for (auto&& handler : handlers) {
+				event += handler;
+			}
+			benchmark::do_not_optimize(event);
+		});
+
+		EventSystem::Event<int> event;
+		for (auto&& handler : handlers) {
+			event += handler;
+		}
+		runner.run("emit/functor/" + std::to_string(handler_count), 1, [&] {
+			event(1);
+			benchmark::do_not_optimize(sum);
+		});
+	}
+
+	for (size_t handler_count : handler_counts) {
+		std::vector<Receiver> receivers(handler_count);
+		EventSystem::Event<int> event;
+		for (auto&& receiver : receivers) {
+			event += EventSystem::createMethodEventHandler(receiver, &Receiver::on_event);
+		}
+		runner.run("emit/method/" + std::to_string(handler_count), 1, [&] {
+			event(1);
+			benchmark::do_not_optimize(receivers.front().sum);
+		});
+	}
+
+	return runner.finish();
+}
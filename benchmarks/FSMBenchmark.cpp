@@ -0,0 +1,73 @@
+#include <string>
+#include "Benchmark.h"
+#include "FSM.h"
+
+namespace {
+	using State = FSM::State<int>;
+
+	const size_t transition_counts[] = { 1, 4, 16, 64 };
+
+	// Two states switching to each other: the last of their transitions fires on odd input,
+	// so a step evaluates every transition of the current state.
+	void build_ping_pong(FSM::FSM<int>& machine, size_t transition_count) {
+		State& ping = machine.add_state([] {});
+		State& pong = machine.add_state([] {});
+		for (size_t i = 1; i < transition_count; ++i) {
+			ping.add_transition([&pong](int& input) -> State* { return input < 0 ? &pong : nullptr; });
+			pong.add_transition([&ping](int& input) -> State* { return input < 0 ? &ping : nullptr; });
+		}
+		ping.add_transition([&pong](int& input) -> State* { return input & 1 ? &pong : nullptr; });
+		pong.add_transition([&ping](int& input) -> State* { return input & 1 ? &ping : nullptr; });
+		machine.set_current_state(ping);
+	}
+}
+
+int main(int argc, char** argv) {
+	benchmark::Runner runner("FSM", argc, argv);
+
+	for (size_t transition_count : transition_counts) {
+		FSM::FSM<int> machine;
+		build_ping_pong(machine, transition_count);
+
+		int input = 1;
+		runner.run("handle/fire_last/" + std::to_string(transition_count), 1, [&] {
+			machine.handle(input);
+		});
+
+		input = 0;
+		runner.run("handle/no_fire/" + std::to_string(transition_count), 1, [&] {
+			machine.handle(input);
+		});
+	}
+
+	{
+		FSM::FSM<int> machine;
+		int counter = 0;
+		machine.set_current_state(machine.add_state([&counter] { ++counter; }));
+		runner.run("execute", 1, [&] {
+			machine.execute();
+			benchmark::do_not_optimize(counter);
+		});
+	}
+
+	{
+		// A shared transition declared once on the root and inherited by a chain of substates.
+		FSM::FSM<int> machine;
+		State* state = &machine.add_state([] {});
+		State& root = *state;
+		for (size_t depth = 1; depth < 8; ++depth) {
+			State& substate = machine.add_substate(*state, [] {});
+			state->set_initial(substate);
+			state = &substate;
+		}
+		root.add_transition([&root](int& input) -> State* { return input & 1 ? &root : nullptr; });
+		machine.set_current_state(root);
+
+		int input = 1;
+		runner.run("handle/inherited_depth_8", 1, [&] {
+			machine.handle(input);
+		});
+	}
+
+	return runner.finish();
+}
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""Compares two sets of benchmark results written by the benchmark executables.
+
+Usage: compare.py <baseline> <current> [--threshold 0.10]
+
+<baseline> and <current> are result files or directories of result files
+(the run_benchmarks target writes them to <build>/benchmark_results).
+Exits with status 1 when a benchmark is slower than the baseline by more
+than the threshold (a fraction of the baseline ns_per_op).
+"""
+import argparse
+import json
+import os
+import sys
+
+
+def load(path):
+    files = [path]
+    if os.path.isdir(path):
+        files = sorted(os.path.join(path, name) for name in os.listdir(path) if name.endswith(".json"))
+    results = {}
+    for file in files:
+        with open(file) as stream:
+            data = json.load(stream)
+        if data.get("schema") != 1:
+            raise ValueError("{}: unsupported schema {}".format(file, data.get("schema")))
+        for benchmark in data["benchmarks"]:
+            results["{}/{}".format(data["suite"], benchmark["name"])] = benchmark["ns_per_op"]
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flag benchmark regressions against a baseline.")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="allowed slowdown as a fraction of the baseline (default: 0.10)")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    regressions = 0
+    for name in sorted(set(baseline) | set(current)):
+        if name not in current:
+            print("{:<50} missing in current results".format(name))
+            continue
+        if name not in baseline:
+            print("{:<50} {:>12.2f} ns/op (new)".format(name, current[name]))
+            continue
+        change = (current[name] - baseline[name]) / baseline[name] if baseline[name] else 0.0
+        status = ""
+        if change > args.threshold:
+            status = "REGRESSION"
+            regressions += 1
+        elif change < -args.threshold:
+            status = "improvement"
+        print("{:<50} {:>12.2f} -> {:>12.2f} ns/op {:>+8.1%} {}".format(name, baseline[name], current[name], change, status))
+
+    if regressions:
+        print("{} benchmark(s) regressed by more than {:.0%}".format(regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,497 @@
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "ECS.h"
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+namespace {
+	int failures = 0;
+
+	void check(bool condition, const char* expression, const char* file, int line) {
+		if (!condition) {
+			std::cerr << file << ":" << line << ": CHECK(" << expression << ") failed" << std::endl;
+			++failures;
+		}
+	}
+
+	struct Position : public ECS::Component {
+		float x = 0, y = 0;
+		virtual Component* copy() const override { return new Position(*this); }
+	};
+
+	struct Velocity : public ECS::Component {
+		float dx = 1, dy = 1;
+		virtual Component* copy() const override { return new Velocity(*this); }
+	};
+
+	// Records the spans emitted by one signal and optionally runs a hook from inside the handler.
+	struct Recorder {
+		std::vector<std::vector<ECS::Entity*>> spans;
+		std::function<void(ECS::Entity&)> hook;
+
+		void operator()(ECS::EntitySpan span) {
+			spans.emplace_back(span.begin(), span.end());
+			if (hook) {
+				for (ECS::Entity* entity : span) hook(*entity);
+			}
+		}
+
+		size_t total() const {
+			size_t count = 0;
+			for (auto&& span : spans) count += span.size();
+			return count;
+		}
+	};
+
+	// Runtime component that counts live instances and can be told to throw from its copy constructor.
+	struct Tracked {
+		static int live;
+		static bool throw_on_copy;
+		int value = 0;
+
+		explicit Tracked(int value) : value(value) { ++live; }
+		Tracked(const Tracked& other) : value(other.value) {
+			if (throw_on_copy) throw std::runtime_error("copy");
+			++live;
+		}
+		Tracked(Tracked&& other) noexcept : value(other.value) { ++live; }
+		~Tracked() { --live; }
+	};
+	int Tracked::live = 0;
+	bool Tracked::throw_on_copy = false;
+
+	template<size_t _Size, size_t _Alignment>
+	class BadLayout : public any::TypeFuctions<int> {
+	public:
+		virtual size_t size() const override { return _Size; }
+		virtual size_t alignment() const override { return _Alignment; }
+		virtual AbstractTypeFuctions* self_copy() const override { return new BadLayout(*this); }
+		virtual void self_destroy() override { delete this; }
+	};
+
+	void subscribe(ECS::ComponentSignal& signal, Recorder& recorder) {
+		signal += EventSystem::Delegate<ECS::EntitySpan>::create(recorder);
+	}
+
+	void test_update_dedupe() {
+		ECS::Registry registry;
+		Recorder updated;
+		subscribe(registry.on_update<Position>(), updated);
+
+		ECS::Entity& entity = registry.create();
+		entity.add_component<Position>();
+		registry.flush();
+		for (int i = 0; i < 5; ++i) entity.mark_updated<Position>();
+		registry.flush();
+		CHECK(updated.spans.size() == 1);
+		CHECK(updated.total() == 1);
+
+		registry.flush();
+		CHECK(updated.spans.size() == 1);
+	}
+
+	void test_construct_dedupe() {
+		ECS::Registry registry;
+		Recorder constructed, updated;
+		subscribe(registry.on_construct<Position>(), constructed);
+		subscribe(registry.on_update<Position>(), updated);
+
+		ECS::Entity& entity = registry.create();
+		entity.add_component<Position>();
+		entity.add_component<Position>();
+		entity.mark_updated<Position>();
+		registry.flush();
+		CHECK(constructed.total() == 1);
+		CHECK(updated.total() == 0);
+	}
+
+	void test_add_remove_cancels() {
+		ECS::Registry registry;
+		Recorder constructed, destroyed;
+		subscribe(registry.on_construct<Position>(), constructed);
+		subscribe(registry.on_destroy<Position>(), destroyed);
+
+		ECS::Entity& entity = registry.create();
+		entity.add_component<Position>();
+		CHECK(entity.remove_component<Position>());
+		CHECK(!entity.has_component<Position>());
+		registry.flush();
+		CHECK(constructed.total() == 0);
+		CHECK(destroyed.total() == 0);
+	}
+
+	void test_remove_readd_updates() {
+		ECS::Registry registry;
+		Recorder updated, destroyed;
+		subscribe(registry.on_update<Position>(), updated);
+		subscribe(registry.on_destroy<Position>(), destroyed);
+
+		ECS::Entity& entity = registry.create();
+		entity.add_component<Position>();
+		registry.flush();
+		entity.remove_component<Position>();
+		entity.add_component<Position>();
+		registry.flush();
+		CHECK(updated.total() == 1);
+		CHECK(destroyed.total() == 0);
+		CHECK(entity.has_component<Position>());
+	}
+
+	void test_removed_component_visible_in_on_destroy() {
+		ECS::Registry registry;
+		Recorder destroyed;
+		bool visible = false;
+		destroyed.hook = [&](ECS::Entity& entity) {
+			visible = entity.has_component<Position>() && entity.get_component<Position>().x == 3;
+		};
+		subscribe(registry.on_destroy<Position>(), destroyed);
+
+		ECS::Entity& entity = registry.create();
+		entity.add_component<Position>().x = 3;
+		registry.flush();
+		CHECK(entity.remove_component<Position>());
+		CHECK(!entity.remove_component<Position>());
+		entity.mark_updated<Position>();
+		registry.flush();
+		CHECK(destroyed.total() == 1);
+		CHECK(visible);
+		CHECK(!entity.has_component<Position>());
+	}
+
+	void test_destroy_flush_ordering() {
+		ECS::Registry registry;
+		Recorder destroyed;
+		bool components_alive = true;
+		destroyed.hook = [&](ECS::Entity& entity) {
+			components_alive = components_alive && entity.has_component<Position>() && entity.has_component<Velocity>();
+		};
+		subscribe(registry.on_destroy<Position>(), destroyed);
+
+		ECS::Entity& entity = registry.create();
+		entity.add_component<Position>();
+		entity.add_component<Velocity>();
+		registry.flush();
+		entity.remove_component<Position>();
+		registry.destroy(entity);
+		registry.destroy(entity);
+		CHECK(registry.size() == 1);
+		registry.flush();
+		CHECK(destroyed.total() == 1);
+		CHECK(components_alive);
+		CHECK(registry.size() == 0);
+	}
+
+	void test_slot_reuse() {
+		ECS::Registry registry;
+		Recorder constructed;
+		subscribe(registry.on_construct<Position>(), constructed);
+
+		ECS::Entity& first = registry.create();
+		first.add_component<Position>();
+		registry.destroy(first);
+		registry.flush();
+		CHECK(constructed.total() == 1);
+
+		ECS::Entity& second = registry.create();
+		CHECK(registry.size() == 1);
+		CHECK(!second.has_component<Position>());
+		second.add_component<Position>();
+		registry.flush();
+		CHECK(constructed.total() == 2);
+	}
+
+	void test_modify_from_handler() {
+		ECS::Registry registry;
+		Recorder constructed, updated, velocity_constructed;
+		std::vector<ECS::Entity*> spawned;
+		constructed.hook = [&](ECS::Entity& entity) {
+			entity.add_component<Velocity>();
+			entity.mark_updated<Position>();
+			if (spawned.empty()) spawned.emplace_back(&registry.create());
+		};
+		subscribe(registry.on_construct<Position>(), constructed);
+		subscribe(registry.on_update<Position>(), updated);
+		subscribe(registry.on_construct<Velocity>(), velocity_constructed);
+
+		ECS::Entity& entity = registry.create();
+		entity.add_component<Position>();
+		registry.flush();
+		CHECK(constructed.total() == 1);
+		CHECK(registry.size() == 2);
+
+		registry.flush();
+		CHECK(updated.total() == 1);
+		CHECK(velocity_constructed.total() == 1);
+		CHECK(constructed.total() == 1);
+	}
+
+	void test_runtime_validation() {
+		ECS::Registry registry;
+		const auto rejects = [&](const any::AbstractTypeFuctions& type_functions) {
+			try {
+				registry.register_component("bad", type_functions);
+			}
+			catch (const std::invalid_argument&) {
+				return true;
+			}
+			return false;
+		};
+		CHECK(rejects(BadLayout<4, 0>()));
+		CHECK(rejects(BadLayout<4, 3>()));
+		CHECK(rejects(BadLayout<0, 4>()));
+		CHECK(!rejects(BadLayout<4, 4>()));
+		CHECK(rejects(any::TypeFuctions<int>()));
+	}
+
+	void test_runtime_swap_remove() {
+		ECS::Registry registry;
+		const ECS::ComponentId id = registry.register_component<int>("int");
+		std::vector<ECS::Entity*> entities;
+		for (int i = 0; i < 20; ++i) {
+			entities.emplace_back(&registry.create());
+			registry.add_component(*entities.back(), id, &i);
+		}
+		registry.flush();
+		CHECK(registry.remove_component(*entities[3], id));
+		CHECK(registry.remove_component(*entities[19], id));
+		CHECK(registry.has_component(*entities[3], id));
+		registry.flush();
+		CHECK(!registry.has_component(*entities[3], id));
+		CHECK(!registry.has_component(*entities[19], id));
+		size_t count = 0;
+		bool consistent = true;
+		registry.each(id, [&](ECS::Entity& entity, void* component) {
+			consistent = consistent && registry.get_component(entity, id) == component;
+			++count;
+		});
+		CHECK(count == 18);
+		CHECK(consistent);
+		for (int i = 0; i < 19; ++i) {
+			if (i == 3) continue;
+			CHECK(*static_cast<int*>(registry.get_component(*entities[i], id)) == i);
+		}
+	}
+
+	void test_runtime_removed_visible_in_on_destroy() {
+		ECS::Registry registry;
+		const ECS::ComponentId id = registry.register_component<int>("int");
+		Recorder destroyed, constructed;
+		int seen = 0;
+		destroyed.hook = [&](ECS::Entity& entity) {
+			if (const void* component = registry.get_component(entity, id)) seen = *static_cast<const int*>(component);
+		};
+		subscribe(registry.on_destroy(id), destroyed);
+		subscribe(registry.on_construct(id), constructed);
+
+		ECS::Entity& entity = registry.create();
+		int value = 7;
+		registry.add_component(entity, id, &value);
+		registry.flush();
+		CHECK(registry.remove_component(entity, id));
+		registry.flush();
+		CHECK(destroyed.total() == 1);
+		CHECK(seen == 7);
+		CHECK(!registry.has_component(entity, id));
+
+		registry.add_component(entity, id, &value);
+		CHECK(registry.remove_component(entity, id));
+		CHECK(!registry.has_component(entity, id));
+		registry.flush();
+		CHECK(constructed.total() == 1);
+		CHECK(destroyed.total() == 1);
+	}
+
+	void test_runtime_exception_safety() {
+		{
+			ECS::Registry registry;
+			const ECS::ComponentId id = registry.register_component<Tracked>("tracked");
+			std::vector<ECS::Entity*> entities;
+			for (int i = 0; i < 8; ++i) {
+				Tracked value(i);
+				entities.emplace_back(&registry.create());
+				registry.add_component(*entities.back(), id, &value);
+			}
+
+			Tracked value(100);
+			Tracked::throw_on_copy = true;
+			bool thrown = false;
+			try {
+				registry.add_component(*entities[2], id, &value);
+			}
+			catch (const std::runtime_error&) {
+				thrown = true;
+			}
+			CHECK(thrown);
+			CHECK(static_cast<Tracked*>(registry.get_component(*entities[2], id))->value == 2);
+
+			// The pool is full: a failed copy must not lose the buffer or the existing components.
+			ECS::Entity& extra = registry.create();
+			thrown = false;
+			try {
+				registry.add_component(extra, id, &value);
+			}
+			catch (const std::runtime_error&) {
+				thrown = true;
+			}
+			Tracked::throw_on_copy = false;
+			CHECK(thrown);
+			CHECK(!registry.has_component(extra, id));
+			CHECK(Tracked::live == 9);
+
+			// Growing from a source inside the pool copies it before the old buffer is released.
+			registry.add_component(extra, id, registry.get_component(*entities[5], id));
+			CHECK(static_cast<Tracked*>(registry.get_component(extra, id))->value == 5);
+			CHECK(static_cast<Tracked*>(registry.get_component(*entities[5], id))->value == 5);
+			registry.flush();
+		}
+		CHECK(Tracked::live == 0);
+	}
+
+	void test_registry_entity_copy_and_move() {
+		ECS::Registry registry;
+		Recorder constructed, destroyed;
+		subscribe(registry.on_construct<Position>(), constructed);
+		subscribe(registry.on_destroy<Position>(), destroyed);
+
+		ECS::Entity& entity = registry.create();
+		entity.add_component<Position>().x = 4;
+		ECS::Entity plain;
+		plain.add_component<Velocity>();
+
+		ECS::Entity copy(entity);
+		CHECK(copy.registry() == nullptr);
+		CHECK(copy.get_component<Position>().x == 4);
+		CHECK(&copy.get_component<Position>().entity() == &copy);
+
+		bool thrown = false;
+		try {
+			ECS::Entity stolen(std::move(entity));
+		}
+		catch (const std::logic_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+
+		thrown = false;
+		try {
+			entity = plain;
+		}
+		catch (const std::logic_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+
+		thrown = false;
+		try {
+			plain = std::move(entity);
+		}
+		catch (const std::logic_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+
+		plain = entity;
+		CHECK(plain.has_component<Position>());
+		CHECK(!plain.has_component<Velocity>());
+		CHECK(entity.has_component<Position>());
+		CHECK(!entity.has_component<Velocity>());
+
+		registry.flush();
+		CHECK(constructed.total() == 1);
+		CHECK(destroyed.total() == 0);
+	}
+
+	void test_create_under_limit() {
+		ECS::Registry registry;
+		// The first attempt appends a slot, the second one reuses the freed slot.
+		for (int attempt = 0; attempt < 2; ++attempt) {
+			if (attempt == 1) {
+				registry.destroy(registry.create());
+				registry.flush();
+			}
+			// One byte of headroom: a zero limit would disable the cap.
+			memory::set_limit(memory::Library::ECS, memory::statistics(memory::Library::ECS).live_bytes + 1);
+			bool thrown = false;
+			try {
+				registry.create();
+			}
+			catch (const std::bad_alloc&) {
+				thrown = true;
+			}
+			memory::set_limit(memory::Library::ECS, 0);
+			CHECK(thrown);
+			CHECK(registry.size() == 0);
+		}
+
+		ECS::Entity& first = registry.create();
+		ECS::Entity& second = registry.create();
+		CHECK(registry.size() == 2);
+		CHECK(&first != &second);
+		registry.destroy(first);
+		registry.destroy(second);
+		registry.flush();
+		CHECK(registry.size() == 0);
+	}
+
+	void test_entity_move_under_limit() {
+		ECS::Entity entity;
+		entity.add_component<Position>().x = 2;
+		memory::set_limit(memory::Library::ECS, memory::statistics(memory::Library::ECS).live_bytes);
+		ECS::Entity moved(std::move(entity));
+		ECS::Entity assigned;
+		assigned = std::move(moved);
+		memory::set_limit(memory::Library::ECS, 0);
+		CHECK(assigned.has_component<Position>());
+		CHECK(assigned.get_component<Position>().x == 2);
+		CHECK(&assigned.get_component<Position>().entity() == &assigned);
+	}
+
+	void test_fixed_event_capacity() {
+		EventSystem::FixedEvent<2, int> event;
+		int calls = 0;
+		auto first = [&](int) { ++calls; };
+		auto second = [&](int) { ++calls; };
+		auto third = [&](int) { ++calls; };
+		CHECK(event += EventSystem::Delegate<int>::create(first));
+		CHECK(!(event += EventSystem::Delegate<int>::create(first)));
+		CHECK(event += EventSystem::Delegate<int>::create(second));
+		bool thrown = false;
+		try {
+			event += EventSystem::Delegate<int>::create(third);
+		}
+		catch (const std::length_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+		event(0);
+		CHECK(calls == 2);
+	}
+}
+
+int main() {
+	test_update_dedupe();
+	test_construct_dedupe();
+	test_add_remove_cancels();
+	test_remove_readd_updates();
+	test_removed_component_visible_in_on_destroy();
+	test_destroy_flush_ordering();
+	test_slot_reuse();
+	test_modify_from_handler();
+	test_runtime_validation();
+	test_runtime_swap_remove();
+	test_runtime_removed_visible_in_on_destroy();
+	test_runtime_exception_safety();
+	test_registry_entity_copy_and_move();
+	test_create_under_limit();
+	test_entity_move_under_limit();
+	test_fixed_event_capacity();
+
+	if (failures) {
+		std::cerr << failures << " check(s) failed" << std::endl;
+		return 1;
+	}
+	std::cout << "All checks passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,170 @@
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "FSM.h"
+
+#ifndef FSM_PROFILING
+#error "FSMProfilingTest must be built with FSM_PROFILING"
+#endif
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+namespace {
+	int failures = 0;
+
+	void check(bool condition, const char* expression, const char* file, int line) {
+		if (!condition) {
+			std::cerr << file << ":" << line << ": CHECK(" << expression << ") failed" << std::endl;
+			++failures;
+		}
+	}
+
+	using State = FSM::State<int>;
+
+	// Minimal JSON syntax checker for the exported documents.
+	class JsonParser {
+	private:
+		const std::string& _text;
+		size_t _position = 0;
+	public:
+		JsonParser(const std::string& text) : _text(text) {}
+
+		bool parse() {
+			if (!value()) return false;
+			skip_whitespace();
+			return _position == _text.size();
+		}
+	private:
+		void skip_whitespace() {
+			while (_position < _text.size() && std::isspace(static_cast<unsigned char>(_text[_position]))) ++_position;
+		}
+
+		bool consume(char symbol) {
+			skip_whitespace();
+			if (_position < _text.size() && _text[_position] == symbol) {
+				++_position;
+				return true;
+			}
+			return false;
+		}
+
+		bool value() {
+			skip_whitespace();
+			if (_position >= _text.size()) return false;
+			const char symbol = _text[_position];
+			if (symbol == '{') return object();
+			if (symbol == '[') return array();
+			if (symbol == '"') return string();
+			return number();
+		}
+
+		bool object() {
+			consume('{');
+			if (consume('}')) return true;
+			do {
+				skip_whitespace();
+				if (!string() || !consume(':') || !value()) return false;
+			} while (consume(','));
+			return consume('}');
+		}
+
+		bool array() {
+			consume('[');
+			if (consume(']')) return true;
+			do {
+				if (!value()) return false;
+			} while (consume(','));
+			return consume(']');
+		}
+
+		bool string() {
+			if (_position >= _text.size() || _text[_position] != '"') return false;
+			for (++_position; _position < _text.size(); ++_position) {
+				if (_text[_position] == '\\') ++_position;
+				else if (_text[_position] == '"') {
+					++_position;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool number() {
+			const size_t start = _position;
+			if (_position < _text.size() && _text[_position] == '-') ++_position;
+			while (_position < _text.size() && std::isdigit(static_cast<unsigned char>(_text[_position]))) ++_position;
+			return _position > start;
+		}
+	};
+
+	void test_edge_counts_and_exports() {
+		FSM::FSM<int> machine;
+		State& idle = machine.add_state([] {});
+		State& busy = machine.add_state([] {});
+		idle.set_name("idle \"quoted\"");
+		busy.set_name("busy");
+		idle.add_transition([&busy](int& input) -> State* { return input == 1 ? &busy : nullptr; });
+		busy.add_transition([&idle](int& input) -> State* { return input == 2 ? &idle : nullptr; });
+		machine.set_current_state(idle);
+
+		const int inputs[] = { 1, 2, 1, 0, 0 };
+		for (int input : inputs) machine.handle(input);
+		machine.execute();
+
+		CHECK(idle.profile().handles == 2);
+		CHECK(busy.profile().handles == 3);
+		CHECK(busy.profile().executions == 1);
+
+		std::ostringstream json;
+		machine.export_json(json);
+		CHECK(JsonParser(json.str()).parse());
+		CHECK(json.str().find("\"name\":\"idle \\\"quoted\\\"\"") != std::string::npos);
+		CHECK(json.str().find("{\"evaluations\":2,\"hits\":2,") != std::string::npos);
+		CHECK(json.str().find("\"targets\":[{\"state\":1,\"count\":2}]") != std::string::npos);
+		CHECK(json.str().find("{\"evaluations\":3,\"hits\":1,") != std::string::npos);
+		CHECK(json.str().find("\"targets\":[{\"state\":0,\"count\":1}]") != std::string::npos);
+
+		std::ostringstream dot;
+		machine.export_dot(dot);
+		CHECK(dot.str().rfind("digraph FSM {\n", 0) == 0);
+		CHECK(dot.str().find("s0 -> s1 [label=\"#0: 2/2") != std::string::npos);
+		CHECK(dot.str().find("s1 -> s0 [label=\"#0: 1/3") != std::string::npos);
+		CHECK(dot.str().find("weight=2];") != std::string::npos);
+		CHECK(dot.str().substr(dot.str().size() - 2) == "}\n");
+
+		machine.reset_profile();
+		std::ostringstream reset;
+		machine.export_json(reset);
+		CHECK(reset.str().find("\"count\"") == std::string::npos);
+	}
+
+	void test_handle_time_excludes_actions() {
+		FSM::FSM<int> machine;
+		State& first = machine.add_state([] {});
+		State& second = machine.add_state([] {});
+		first.add_transition([&second](int&) -> State* { return &second; });
+		first.set_exit([] { std::this_thread::sleep_for(std::chrono::milliseconds(20)); });
+		second.set_entry([] { std::this_thread::sleep_for(std::chrono::milliseconds(20)); });
+		machine.set_current_state(first);
+
+		machine.handle(0);
+		CHECK(&machine.current_state() == &second);
+		CHECK(first.profile().handles == 1);
+		CHECK(first.profile().handle_time < std::chrono::milliseconds(20));
+	}
+}
+
+int main() {
+	test_edge_counts_and_exports();
+	test_handle_time_excludes_actions();
+
+	if (failures) {
+		std::cerr << failures << " check(s) failed" << std::endl;
+		return 1;
+	}
+	std::cout << "All checks passed" << std::endl;
+	return 0;
+}
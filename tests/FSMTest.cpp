@@ -0,0 +1,221 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "FSM.h"
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+namespace {
+	int failures = 0;
+
+	void check(bool condition, const char* expression, const char* file, int line) {
+		if (!condition) {
+			std::cerr << file << ":" << line << ": CHECK(" << expression << ") failed" << std::endl;
+			++failures;
+		}
+	}
+
+	using State = FSM::State<int>;
+
+	template<class _Function>
+	bool throws_logic_error(_Function&& function) {
+		try {
+			function();
+		}
+		catch (const std::logic_error&) {
+			return true;
+		}
+		return false;
+	}
+
+	// Logs "+name" on entry and "-name" on exit.
+	void trace(State& state, const std::string& name, std::string& log) {
+		state.set_name(name);
+		state.set_entry([&state, &log] { log += "+" + state.name() + " "; });
+		state.set_exit([&state, &log] { log += "-" + state.name() + " "; });
+	}
+
+	// root
+	//   a        (initial a1)
+	//     a1
+	//   b        (initial b1)
+	//     b1
+	struct Hierarchy {
+		FSM::FSM<int> machine;
+		std::string log;
+		State& root = machine.add_state([] {});
+		State& a = machine.add_substate(root, [] {});
+		State& a1 = machine.add_substate(a, [] {});
+		State& b = machine.add_substate(root, [] {});
+		State& b1 = machine.add_substate(b, [] {});
+
+		Hierarchy() {
+			trace(root, "root", log);
+			trace(a, "a", log);
+			trace(a1, "a1", log);
+			trace(b, "b", log);
+			trace(b1, "b1", log);
+			root.set_initial(a);
+			a.set_initial(a1);
+			b.set_initial(b1);
+		}
+	};
+
+	void test_initial_descent() {
+		Hierarchy hierarchy;
+		hierarchy.machine.set_current_state(hierarchy.root);
+		CHECK(&hierarchy.machine.current_state() == &hierarchy.a1);
+		CHECK(hierarchy.log.empty());
+	}
+
+	void test_common_ancestor_order() {
+		Hierarchy hierarchy;
+		State& b = hierarchy.b;
+		hierarchy.a1.add_transition([&b](int& input) -> State* { return input == 1 ? &b : nullptr; });
+		hierarchy.machine.set_current_state(hierarchy.a1);
+
+		hierarchy.machine.handle(1);
+		CHECK(hierarchy.log == "-a1 -a +b +b1 ");
+		CHECK(&hierarchy.machine.current_state() == &hierarchy.b1);
+	}
+
+	void test_self_transition() {
+		Hierarchy hierarchy;
+		State& a1 = hierarchy.a1;
+		a1.add_transition([&a1](int& input) -> State* { return input == 1 ? &a1 : nullptr; });
+		hierarchy.machine.set_current_state(a1);
+
+		hierarchy.machine.handle(1);
+		CHECK(hierarchy.log == "-a1 +a1 ");
+		CHECK(&hierarchy.machine.current_state() == &a1);
+	}
+
+	void test_inherited_transitions() {
+		Hierarchy hierarchy;
+		State& a1 = hierarchy.a1;
+		State& b1 = hierarchy.b1;
+		int parent_evaluations = 0;
+		hierarchy.a1.add_transition([&b1](int& input) -> State* { return input == 1 ? &b1 : nullptr; });
+		hierarchy.root.add_transition([&a1, &parent_evaluations](int& input) -> State* {
+			++parent_evaluations;
+			return input <= 2 ? &a1 : nullptr;
+		});
+		hierarchy.machine.set_current_state(a1);
+
+		// The substate's own transition wins, the parent's one is not evaluated.
+		hierarchy.machine.handle(1);
+		CHECK(&hierarchy.machine.current_state() == &b1);
+		CHECK(parent_evaluations == 0);
+
+		// b1 has no transitions of its own and falls back to the root.
+		hierarchy.log.clear();
+		hierarchy.machine.handle(2);
+		CHECK(&hierarchy.machine.current_state() == &a1);
+		CHECK(parent_evaluations == 1);
+		CHECK(hierarchy.log == "-b1 -b +a +a1 ");
+
+		hierarchy.machine.handle(3);
+		CHECK(&hierarchy.machine.current_state() == &a1);
+		CHECK(parent_evaluations == 2);
+	}
+
+	void test_execute_runs_ancestors_first() {
+		FSM::FSM<int> machine;
+		std::string log;
+		State& parent = machine.add_state([&log] { log += "parent "; });
+		State& child = machine.add_substate(parent, [&log] { log += "child "; });
+		machine.set_current_state(child);
+		machine.execute();
+		CHECK(log == "parent child ");
+	}
+
+	void test_hierarchy_errors() {
+		Hierarchy hierarchy;
+		CHECK(throws_logic_error([&] { hierarchy.a.set_parent(hierarchy.a1); }));
+		CHECK(throws_logic_error([&] { hierarchy.a.set_parent(hierarchy.a); }));
+		CHECK(throws_logic_error([&] { hierarchy.root.set_parent(hierarchy.b1); }));
+		CHECK(hierarchy.a.parent() == &hierarchy.root);
+		CHECK(throws_logic_error([&] { hierarchy.a.set_initial(hierarchy.b1); }));
+		CHECK(throws_logic_error([&] { hierarchy.machine.handle(0); }));
+	}
+
+	void test_region_overlap() {
+		FSM::FSM<int> machine;
+		State& x = machine.add_state([] {});
+		State& x1 = machine.add_substate(x, [] {});
+		State& y = machine.add_state([] {});
+		machine.set_current_state(x);
+		CHECK(throws_logic_error([&] { machine.add_region(x1); }));
+		CHECK(machine.regions_count() == 1);
+		CHECK(machine.add_region(y) == 1);
+		CHECK(throws_logic_error([&] { machine.set_current_state(y); }));
+		CHECK(&machine.current_state(0) == &x);
+	}
+
+	void test_transition_into_other_region() {
+		FSM::FSM<int> machine;
+		std::string log;
+		State& a = machine.add_state([] {});
+		State& b = machine.add_state([] {});
+		State& c = machine.add_substate(b, [] {});
+		State& y = machine.add_state([] {});
+		trace(a, "a", log);
+		trace(c, "c", log);
+		trace(y, "y", log);
+		// Region 0 moves a -> c, region 1 would move y into region 0.
+		a.add_transition([&c](int& input) -> State* { return input == 1 ? &c : nullptr; });
+		y.add_transition([&a](int& input) -> State* { return input == 1 ? &a : nullptr; });
+		machine.set_current_state(a);
+		machine.add_region(y);
+
+		CHECK(throws_logic_error([&] { machine.handle(1); }));
+		CHECK(log.empty());
+		CHECK(&machine.current_state(0) == &a);
+		CHECK(&machine.current_state(1) == &y);
+
+		// The machine is still usable after the rejected step.
+		machine.handle(0);
+		CHECK(&machine.current_state(0) == &a);
+	}
+
+	void test_regions_advance_together() {
+		FSM::FSM<int> machine;
+		std::string log;
+		State& a = machine.add_state([] {});
+		State& b = machine.add_state([] {});
+		State& x = machine.add_state([] {});
+		State& y = machine.add_state([] {});
+		trace(a, "a", log);
+		trace(b, "b", log);
+		trace(x, "x", log);
+		trace(y, "y", log);
+		a.add_transition([&b](int& input) -> State* { return input == 1 ? &b : nullptr; });
+		x.add_transition([&y](int& input) -> State* { return input == 1 ? &y : nullptr; });
+		machine.set_current_state(a);
+		machine.add_region(x);
+
+		machine.handle(1);
+		CHECK(log == "-a +b -x +y ");
+		CHECK(&machine.current_state(0) == &b);
+		CHECK(&machine.current_state(1) == &y);
+	}
+}
+
+int main() {
+	test_initial_descent();
+	test_common_ancestor_order();
+	test_self_transition();
+	test_inherited_transitions();
+	test_execute_runs_ancestors_first();
+	test_hierarchy_errors();
+	test_region_overlap();
+	test_transition_into_other_region();
+	test_regions_advance_together();
+
+	if (failures) {
+		std::cerr << failures << " check(s) failed" << std::endl;
+		return 1;
+	}
+	std::cout << "All checks passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,179 @@
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "Memory.h"
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+namespace {
+	int failures = 0;
+
+	void check(bool condition, const char* expression, const char* file, int line) {
+		if (!condition) {
+			std::cerr << file << ":" << line << ": CHECK(" << expression << ") failed" << std::endl;
+			++failures;
+		}
+	}
+
+	// Only this test allocates to the FSM library, so its statistics start at zero.
+	constexpr memory::Library library = memory::Library::FSM;
+
+	struct Probe {
+		char payload[24] = {};
+	};
+
+	struct VectorTag {};
+	struct ThreadTag {};
+
+	class CountingAllocator : public memory::DefaultAllocator {
+	public:
+		size_t allocations = 0;
+		bool fail = false;
+
+		virtual void* allocate(size_t size, size_t alignment) override {
+			if (fail) throw std::bad_alloc();
+			++allocations;
+			return memory::DefaultAllocator::allocate(size, alignment);
+		}
+	};
+
+	void test_concurrent_limit() {
+		const size_t limit = 4096;
+		const size_t block = 64;
+		memory::set_limit(library, limit);
+		std::vector<std::thread> threads;
+		for (int i = 0; i < 8; ++i) {
+			threads.emplace_back([] {
+				std::vector<void*> blocks;
+				for (int round = 0; round < 2000; ++round) {
+					try {
+						blocks.emplace_back(memory::allocate<library, ThreadTag>(block, alignof(std::max_align_t)));
+					}
+					catch (const std::bad_alloc&) {}
+					if (blocks.size() == 16 || round % 7 == 0) {
+						for (void* pointer : blocks) memory::deallocate<library, ThreadTag>(pointer, block, alignof(std::max_align_t));
+						blocks.clear();
+					}
+				}
+				for (void* pointer : blocks) memory::deallocate<library, ThreadTag>(pointer, block, alignof(std::max_align_t));
+			});
+		}
+		for (auto&& thread : threads) thread.join();
+		memory::set_limit(library, 0);
+
+		const memory::Statistics statistics = memory::statistics(library);
+		CHECK(statistics.live_bytes == 0);
+		CHECK(statistics.peak_bytes <= limit);
+		CHECK(statistics.allocations == statistics.deallocations);
+		CHECK(memory::type_statistics<ThreadTag>().allocations == statistics.allocations);
+	}
+
+	void test_accounting() {
+		const memory::Statistics before = memory::statistics(library);
+
+		Probe* probe = memory::create<library, Probe>();
+		memory::Statistics statistics = memory::statistics(library);
+		CHECK(statistics.live_bytes == before.live_bytes + sizeof(Probe));
+		CHECK(statistics.allocations == before.allocations + 1);
+		CHECK(statistics.peak_bytes >= statistics.live_bytes);
+		CHECK(memory::type_statistics<Probe>().live_bytes == sizeof(Probe));
+		CHECK(memory::type_statistics<const Probe>().live_bytes == sizeof(Probe));
+
+		{
+			std::vector<int, memory::Allocator<int, library, VectorTag>> values(100);
+			CHECK(memory::type_statistics<VectorTag>().live_bytes == 100 * sizeof(int));
+			CHECK(memory::statistics(library).live_bytes == before.live_bytes + sizeof(Probe) + 100 * sizeof(int));
+		}
+		CHECK(memory::type_statistics<VectorTag>().live_bytes == 0);
+		CHECK(memory::type_statistics<VectorTag>().allocations == memory::type_statistics<VectorTag>().deallocations);
+
+		memory::destroy<library>(probe);
+		statistics = memory::statistics(library);
+		CHECK(statistics.live_bytes == before.live_bytes);
+		CHECK(statistics.deallocations == before.deallocations + 2);
+		CHECK(statistics.peak_bytes >= before.live_bytes + sizeof(Probe) + 100 * sizeof(int));
+		CHECK(memory::type_statistics<Probe>().live_bytes == 0);
+		CHECK(memory::type_statistics<Probe>().deallocations == 1);
+
+		std::ostringstream json;
+		memory::write_json(json);
+		CHECK(json.str().find("{\"name\":\"FSM\",\"limit\":0,\"live_bytes\":0,") != std::string::npos);
+	}
+
+	void test_limit() {
+		const memory::Statistics before = memory::statistics(library);
+		memory::set_limit(library, before.live_bytes + sizeof(Probe));
+		CHECK(memory::limit(library) == before.live_bytes + sizeof(Probe));
+
+		Probe* probe = memory::create<library, Probe>();
+		bool thrown = false;
+		try {
+			memory::create<library, Probe>();
+		}
+		catch (const std::bad_alloc&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+		CHECK(memory::statistics(library).live_bytes == before.live_bytes + sizeof(Probe));
+		CHECK(memory::statistics(library).allocations == before.allocations + 1);
+
+		memory::destroy<library>(probe);
+		memory::set_limit(library, 0);
+		memory::destroy<library>(memory::create<library, Probe>());
+	}
+
+	void test_set_allocator() {
+		memory::AbstractAllocator& original = memory::allocator();
+		CountingAllocator counting;
+
+		Probe* probe = memory::create<library, Probe>();
+		bool refused = false;
+		try {
+			memory::set_allocator(counting);
+		}
+		catch (const std::logic_error&) {
+			refused = true;
+		}
+		CHECK(refused);
+		CHECK(&memory::allocator() == &original);
+		memory::destroy<library>(probe);
+
+		memory::set_allocator(counting);
+		probe = memory::create<library, Probe>();
+		CHECK(counting.allocations == 1);
+		memory::destroy<library>(probe);
+
+		// A throwing allocator leaves the accounting untouched.
+		const memory::Statistics before = memory::statistics(library);
+		counting.fail = true;
+		bool thrown = false;
+		try {
+			memory::create<library, Probe>();
+		}
+		catch (const std::bad_alloc&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+		CHECK(memory::statistics(library).live_bytes == before.live_bytes);
+		CHECK(memory::statistics(library).allocations == before.allocations);
+
+		memory::set_allocator(original);
+	}
+}
+
+int main() {
+	test_concurrent_limit();
+	test_accounting();
+	test_limit();
+	test_set_allocator();
+
+	if (failures) {
+		std::cerr << failures << " check(s) failed" << std::endl;
+		return 1;
+	}
+	std::cout << "All checks passed" << std::endl;
+	return 0;
+}